@@ -0,0 +1,114 @@
+// affinity.c - control/worker core split for --affinity (see affinity.h)
+#define _GNU_SOURCE
+#include "affinity.h"
+#include <dirent.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static cpu_set_t g_control;
+static int *g_workers;          // worker cores, in order
+static int g_nworkers;
+static bool g_on;
+
+// "0-2,5" -> set; -1 on syntax errors
+static int parse_list(const char *s, cpu_set_t *set) {
+    CPU_ZERO(set);
+    while (*s) {
+        char *end;
+        long lo = strtol(s, &end, 10), hi = lo;
+        if (end == s || lo < 0) return -1;
+        if (*end == '-') {
+            s = end + 1;
+            hi = strtol(s, &end, 10);
+            if (end == s || hi < lo) return -1;
+        }
+        if (hi >= CPU_SETSIZE) return -1;
+        for (long c = lo; c <= hi; c++) CPU_SET(c, set);
+        if (*end == ',') end++;
+        else if (*end) return -1;
+        s = end;
+    }
+    return 0;
+}
+
+int affinity_init(const char *control_cpus) {
+    cpu_set_t allowed, want;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0) return -1;
+    if (parse_list(control_cpus, &want) < 0) return -1;
+    CPU_AND(&g_control, &want, &allowed);
+    if (CPU_COUNT(&g_control) == 0) return -1;
+
+    g_workers = malloc(sizeof(int) * CPU_SETSIZE);
+    if (!g_workers) return -1;
+    g_nworkers = 0;
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+        if (CPU_ISSET(c, &allowed) && !CPU_ISSET(c, &g_control)) g_workers[g_nworkers++] = c;
+    }
+    if (g_nworkers == 0) {
+        // Everything is reserved: jobs still get one core each, shared
+        for (int c = 0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &g_control)) g_workers[g_nworkers++] = c;
+        }
+    }
+    g_on = true;
+    return 0;
+}
+
+bool affinity_on(void) {
+    return g_on;
+}
+
+int affinity_workers(void) {
+    return g_on ? g_nworkers : 0;
+}
+
+void affinity_pin_control(void) {
+    if (g_on) sched_setaffinity(0, sizeof(g_control), &g_control);
+}
+
+int affinity_core(int cpu) {
+    if (!g_on || cpu < 0) return -1;
+    return g_workers[cpu % g_nworkers];
+}
+
+// Pins every thread of `pid`, then the processes those threads forked,
+// found through /proc/<pid>/task/<tid>/children
+static int pin_tree(pid_t pid, const cpu_set_t *set) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task", (int)pid);
+    DIR *d = opendir(path);
+    if (!d) return sched_setaffinity(pid, sizeof(*set), set);
+    int rc = 0;
+    struct dirent *e;
+    while ((e = readdir(d))) {
+        if (e->d_name[0] == '.') continue;
+        int tid = atoi(e->d_name);
+        if (sched_setaffinity((pid_t)tid, sizeof(*set), set) < 0) rc = -1;
+
+        char cpath[96];
+        snprintf(cpath, sizeof(cpath), "/proc/%d/task/%d/children", (int)pid, tid);
+        FILE *f = fopen(cpath, "r");
+        if (!f) continue;  // no CONFIG_PROC_CHILDREN: only pid's own threads
+        int child;
+        while (fscanf(f, "%d", &child) == 1) {
+            if (pin_tree((pid_t)child, set) < 0) rc = -1;
+        }
+        fclose(f);
+    }
+    closedir(d);
+    return rc;
+}
+
+int affinity_pin_pid(pid_t pid, int core) {
+    if (core < 0) return 0;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    if (pid == 0) return sched_setaffinity(0, sizeof(set), &set);
+
+    // sched_setaffinity() takes one thread: walk them all, and the
+    // processes the job has forked since
+    return pin_tree(pid, &set);
+}
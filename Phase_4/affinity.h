@@ -0,0 +1,38 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+#include <stdbool.h>
+#include <sys/types.h>
+
+// ---------------------------------------------------------------------------
+// CPU affinity (server --affinity=CPUS).
+//
+// CPUS is a core list like "0" or "0-1,6" reserved for the server's own
+// threads (acceptors, event loops, scheduler, connection and job threads).
+// The cores left over from the process's allowed set are worker cores:
+// scheduler CPU k runs its jobs on worker core k % (number of workers), so
+// a job that resumes on the scheduler CPU it last ran on finds its cache
+// where it left it. With no core left over, jobs share the control cores.
+// ---------------------------------------------------------------------------
+
+// Parses the control list and splits the allowed cores. Returns -1 on a bad
+// list (or one naming no allowed core).
+int affinity_init(const char *control_cpus);
+bool affinity_on(void);
+int affinity_workers(void);         // number of worker cores (0 when off)
+
+// Pins the calling thread to the control cores; threads it creates later
+// inherit that.
+void affinity_pin_control(void);
+
+// Worker core that scheduler CPU `cpu` maps to, or -1 when off
+int affinity_core(int cpu);
+
+// Pins every thread of process `pid` and of the processes it has forked
+// (pipeline stages, a workload's helpers) to `core`; 0 pins the calling
+// process, e.g. a child right after fork(), so all it execs and forks
+// inherits it. Descendants are found through /proc/<pid>/task/<tid>/children:
+// without CONFIG_PROC_CHILDREN only `pid` itself moves, and a process
+// forked while the tree is walked may be missed.
+int affinity_pin_pid(pid_t pid, int core);
+
+#endif
@@ -0,0 +1,126 @@
+// bench_accept.c - connection storm against one vs. sharded (SO_REUSEPORT)
+// listeners: accept rate and connect() latency percentiles.
+//
+// Client threads connect as fast as they can and reset each connection
+// right away (SO_LINGER 0, so loopback never runs out of ports in
+// TIME_WAIT). Acceptor threads accept and close, like a server that is
+// busy setting connections up.
+//
+// Usage: ./bench_accept [clients] [connects_per_client] [shards]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "net.h"
+
+#define BENCH_PORT 5097
+
+static int g_clients, g_per_client;
+static volatile int g_stop;
+static unsigned long g_accepted;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *acceptor(void *arg) {
+    int lfd = (int)(intptr_t)arg;
+    while (!g_stop) {
+        int cfd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+        if (cfd < 0) continue;
+        __atomic_add_fetch(&g_accepted, 1, __ATOMIC_RELAXED);
+        close(cfd);
+    }
+    return NULL;
+}
+
+typedef struct {
+    uint16_t port;
+    double *lat;        // connect latency per attempt, seconds
+    int failed;
+} Client;
+
+static void *client(void *arg) {
+    Client *c = arg;
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(c->port) };
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    struct linger lg = { 1, 0 };
+    for (int i = 0; i < g_per_client; i++) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        double t0 = now_sec();
+        int rc = connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+        c->lat[i] = now_sec() - t0;
+        if (rc < 0) c->failed++;
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+        close(fd);
+    }
+    return NULL;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void run(const char *name, uint16_t port, int shards, int backlog) {
+    int lfds[64];
+    if (shards == 1) lfds[0] = tcp_listen_backlog(port, backlog, false);
+    else if (tcp_listen_shards(port, backlog, shards, lfds) < 0) lfds[0] = -1;
+    if (lfds[0] < 0) { perror("listen"); exit(1); }
+
+    g_stop = 0;
+    g_accepted = 0;
+    pthread_t at[64];
+    for (int i = 0; i < shards; i++) pthread_create(&at[i], NULL, acceptor, (void *)(intptr_t)lfds[i]);
+
+    int total = g_clients * g_per_client;
+    double *lat = malloc(sizeof(double) * total);
+    Client *cs = calloc(g_clients, sizeof(Client));
+    pthread_t *ct = malloc(sizeof(pthread_t) * g_clients);
+
+    double t0 = now_sec();
+    for (int i = 0; i < g_clients; i++) {
+        cs[i].port = port;
+        cs[i].lat = lat + (size_t)i * g_per_client;
+        pthread_create(&ct[i], NULL, client, &cs[i]);
+    }
+    int failed = 0;
+    for (int i = 0; i < g_clients; i++) { pthread_join(ct[i], NULL); failed += cs[i].failed; }
+    double dt = now_sec() - t0;
+
+    // Wake the acceptors out of accept() by closing their sockets
+    g_stop = 1;
+    for (int i = 0; i < shards; i++) shutdown(lfds[i], SHUT_RDWR);
+    for (int i = 0; i < shards; i++) { pthread_join(at[i], NULL); close(lfds[i]); }
+
+    qsort(lat, total, sizeof(double), cmp_double);
+    printf("%-22s %9.0f accepts/s  connect p50 %7.1f us  p99 %8.1f us  p99.9 %9.1f us  max %9.1f us  failed %d\n",
+           name, g_accepted / dt, lat[total / 2] * 1e6, lat[(int)(total * 0.99)] * 1e6,
+           lat[(int)(total * 0.999)] * 1e6, lat[total - 1] * 1e6, failed);
+    free(lat); free(cs); free(ct);
+}
+
+int main(int argc, char **argv) {
+    g_clients = argc > 1 ? atoi(argv[1]) : 8;
+    g_per_client = argc > 2 ? atoi(argv[2]) : 1000;
+    int shards = argc > 3 ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (shards < 1) shards = 1;
+    if (shards > 64) shards = 64;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("%d clients x %d connects\n", g_clients, g_per_client);
+    run("1 listener, backlog 16", BENCH_PORT, 1, 16);
+    run("1 listener, backlog 1024", BENCH_PORT + 1, 1, 1024);
+    char name[64];
+    snprintf(name, sizeof(name), "%d shards, backlog 1024", shards);
+    run(name, BENCH_PORT + 2, shards, 1024);
+    return 0;
+}
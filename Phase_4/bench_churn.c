@@ -0,0 +1,195 @@
+// bench_churn.c - connection churn against a thread-per-connection server
+// vs. the worker pool (pool.c): elapsed time, threads created/avoided and
+// peak memory of the serving process.
+//
+// Each round opens a burst of connections and keeps them all open (a
+// handler is busy for as long as its connection lives), pings each one,
+// then closes them all. Every model runs in its own forked server process
+// so VmPeak/VmHWM are its own. The last run caps the pool at half the
+// burst, like a server past --pool-max: the other half must be turned
+// away at once (counted as failed), not left waiting for a worker.
+//
+// Usage: ./bench_churn [burst] [rounds] [stack_kb]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "net.h"
+#include "pool.h"
+
+#define BENCH_PORT 5101
+#define CLIENT_THREADS 8
+
+static int g_burst, g_rounds, g_stack_kb;
+static unsigned long g_done;        // server side: connections finished
+static unsigned long g_created;     // server side: threads created (per-connection model)
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Server side handler: answer one ping, then wait for the client to leave
+static void handle_conn(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    char buf[4];
+    if (readn(fd, buf, sizeof(buf)) == sizeof(buf)) {
+        (void)writen(fd, buf, sizeof(buf));
+        while (read(fd, buf, sizeof(buf)) > 0) {}
+    }
+    close(fd);
+    __atomic_add_fetch(&g_done, 1, __ATOMIC_RELEASE);
+}
+
+static void *conn_thread(void *arg) {
+    handle_conn(arg);
+    return NULL;
+}
+
+// "VmPeak:   123456 kB" -> 123456
+static long status_kb(const char *key) {
+    FILE *f = fopen("/proc/self/status", "r");
+    if (!f) return -1;
+    char line[256];
+    long v = -1;
+    size_t klen = strlen(key);
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, key, klen) == 0 && line[klen] == ':') {
+            v = atol(line + klen + 1);
+            break;
+        }
+    }
+    fclose(f);
+    return v;
+}
+
+// Runs in the forked child: accepts until every connection has been served
+static void serve(int lfd, bool use_pool, int pool_max) {
+    WorkerPool *pool = NULL;
+    if (use_pool) pool = pool_create(4, pool_max, (size_t)g_stack_kb * 1024, 1000);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    unsigned long total = (unsigned long)g_burst * g_rounds, accepted = 0;
+    while (accepted < total) {
+        int cfd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+        if (cfd < 0) continue;
+        accepted++;
+        if (pool) {
+            if (pool_submit(pool, handle_conn, (void *)(intptr_t)cfd) < 0) {
+                close(cfd);     // the server sends its busy frame here
+                __atomic_add_fetch(&g_done, 1, __ATOMIC_RELEASE);
+            }
+            continue;
+        }
+        pthread_t tid;
+        if (pthread_create(&tid, &attr, conn_thread, (void *)(intptr_t)cfd) == 0) {
+            g_created++;
+        } else {
+            close(cfd);
+            __atomic_add_fetch(&g_done, 1, __ATOMIC_RELEASE);
+        }
+    }
+    while (__atomic_load_n(&g_done, __ATOMIC_ACQUIRE) < total) usleep(1000);
+
+    unsigned long created = g_created, avoided = 0;
+    int peak = 0;
+    if (pool) {
+        PoolStats ps;
+        pool_stats(pool, &ps);
+        created = ps.threads_created;
+        avoided = ps.tasks - ps.threads_created;
+        peak = ps.peak_threads;
+    }
+    printf("  threads created %7lu  avoided %7lu  peak workers %5d  VmPeak %8ld kB  VmHWM %7ld kB\n",
+           created, avoided, peak, status_kb("VmPeak"), status_kb("VmHWM"));
+    fflush(stdout);
+}
+
+typedef struct {
+    uint16_t port;
+    int *fds;
+    int n;
+    int failed;
+} Client;
+
+static void *client(void *arg) {
+    Client *c = arg;
+    for (int i = 0; i < c->n; i++) {
+        c->fds[i] = -1;
+        int fd = tcp_connect("127.0.0.1", c->port);
+        char buf[4] = "ping";
+        if (fd < 0 || writen(fd, buf, 4) != 4 || readn(fd, buf, 4) != 4) {
+            if (fd >= 0) close(fd);
+            c->failed++;
+            continue;
+        }
+        c->fds[i] = fd;
+    }
+    return NULL;
+}
+
+static void run(const char *name, uint16_t port, bool use_pool, int pool_max) {
+    int lfd = tcp_listen_backlog(port, 1024, false);
+    if (lfd < 0) { perror("listen"); exit(1); }
+
+    printf("%s\n", name);
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        serve(lfd, use_pool, pool_max);
+        _exit(0);
+    }
+    close(lfd);
+
+    int *fds = malloc(sizeof(int) * g_burst);
+    Client cs[CLIENT_THREADS];
+    pthread_t ct[CLIENT_THREADS];
+    int failed = 0;
+    double t0 = now_sec();
+    for (int r = 0; r < g_rounds; r++) {
+        int per = g_burst / CLIENT_THREADS, off = 0;
+        for (int i = 0; i < CLIENT_THREADS; i++) {
+            cs[i] = (Client){ port, fds + off, per + (i < g_burst % CLIENT_THREADS), 0 };
+            off += cs[i].n;
+            pthread_create(&ct[i], NULL, client, &cs[i]);
+        }
+        for (int i = 0; i < CLIENT_THREADS; i++) { pthread_join(ct[i], NULL); failed += cs[i].failed; }
+        // The whole burst is connected and served: hang up
+        for (int i = 0; i < g_burst; i++) if (fds[i] >= 0) close(fds[i]);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    double dt = now_sec() - t0;
+    printf("  %.2f s, %.0f conns/s, failed %d\n", dt, g_burst * (double)g_rounds / dt, failed);
+    free(fds);
+}
+
+int main(int argc, char **argv) {
+    g_burst = argc > 1 ? atoi(argv[1]) : 5000;
+    g_rounds = argc > 2 ? atoi(argv[2]) : 5;
+    g_stack_kb = argc > 3 ? atoi(argv[3]) : 256;
+    if (g_burst < 1) g_burst = 1;
+    if (g_rounds < 1) g_rounds = 1;
+    if (g_stack_kb < 64) g_stack_kb = 64;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("%d rounds x %d held connections\n", g_rounds, g_burst);
+    run("thread per connection (default stack)", BENCH_PORT, false, 0);
+    char name[64];
+    snprintf(name, sizeof(name), "worker pool (%d KB stacks)", g_stack_kb);
+    run(name, BENCH_PORT + 1, true, g_burst);
+    int cap = g_burst / 2 > 0 ? g_burst / 2 : 1;
+    snprintf(name, sizeof(name), "worker pool capped at %d (past pool_max)", cap);
+    run(name, BENCH_PORT + 2, true, cap);
+    return 0;
+}
@@ -0,0 +1,114 @@
+// bench_io.c - compares the net and io_uring I/O backends on the
+// execute_shell_job pattern: read a chunk from a child pipe, send it as a frame.
+//
+// Usage: ./bench_io [total_MB] [chunk_bytes]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include "net.h"
+#include "io.h"
+
+#define BENCH_PORT 5099
+
+static size_t g_total;
+static size_t g_chunk;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Stands in for the child process: writes g_total bytes into the pipe
+static void *producer(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    char *buf = malloc(g_chunk);
+    memset(buf, 'x', g_chunk);
+    size_t left = g_total;
+    while (left > 0) {
+        size_t n = left < g_chunk ? left : g_chunk;
+        if (writen(fd, buf, n) < 0) break;
+        left -= n;
+    }
+    close(fd);
+    free(buf);
+    return NULL;
+}
+
+// Stands in for the client: drains the socket
+static void *sink(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    char buf[65536];
+    while (read(fd, buf, sizeof(buf)) > 0) {}
+    close(fd);
+    return NULL;
+}
+
+static void run(IoBackend want, int lfd) {
+    IoBackend b = io_set_backend(want);
+    if (b != want) {
+        printf("%-6s  (unavailable, skipped)\n", io_backend_name(want));
+        return;
+    }
+
+    int cfd = tcp_connect("127.0.0.1", BENCH_PORT);
+    int sfd = accept(lfd, NULL, NULL);
+    int pfd[2];
+    if (cfd < 0 || sfd < 0 || pipe(pfd) < 0) { perror("setup"); exit(1); }
+
+    pthread_t pt, st;
+    pthread_create(&st, NULL, sink, (void *)(intptr_t)cfd);
+    pthread_create(&pt, NULL, producer, (void *)(intptr_t)pfd[1]);
+
+    char *buf[2] = { malloc(g_chunk), malloc(g_chunk) };
+    int cur = 0;
+    unsigned long frames = 0, sys0 = io_syscalls();
+    double t0 = now_sec();
+
+    // Same loop shape as execute_shell_job
+    ssize_t r = io_read(pfd[0], buf[cur], g_chunk);
+    while (r > 0) {
+        int rc;
+        ssize_t next = io_send_frame_and_read(sfd, buf[cur], (uint32_t)r,
+                                              pfd[0], buf[cur ^ 1], g_chunk, &rc);
+        if (rc < 0) break;
+        frames++;
+        cur ^= 1;
+        r = next;
+    }
+    io_send_frame(sfd, NULL, 0);
+    double dt = now_sec() - t0;
+    unsigned long sys = io_syscalls() - sys0;
+
+    close(sfd);
+    close(pfd[0]);
+    pthread_join(pt, NULL);
+    pthread_join(st, NULL);
+    free(buf[0]); free(buf[1]);
+
+    printf("%-6s  %9lu frames  %8.1f MB/s  %9.0f frames/s  %5.2f syscalls/frame\n",
+           io_backend_name(b), frames, g_total / dt / 1e6, frames / dt,
+           frames ? (double)sys / frames : 0.0);
+}
+
+int main(int argc, char **argv) {
+    signal(SIGPIPE, SIG_IGN);
+    g_total = (size_t)(argc > 1 ? atoi(argv[1]) : 256) * 1024 * 1024;
+    g_chunk = argc > 2 ? (size_t)atoi(argv[2]) : 1024;   // execute_shell_job uses 1 KB
+
+    int lfd = tcp_listen(BENCH_PORT);
+    if (lfd < 0) { perror("listen"); return 1; }
+
+    printf("pipe -> frame -> loopback TCP, %zu MB in %zu-byte chunks\n",
+           g_total / (1024 * 1024), g_chunk);
+    run(IO_BACKEND_NET, lfd);
+    run(IO_BACKEND_URING, lfd);
+    close(lfd);
+    return 0;
+}
@@ -0,0 +1,115 @@
+// bench_libclient.c - commands per second from one process through
+// libclient, for a few pool sizes and windows, against a local server.
+//
+// Starts ./server itself (threads mode, then reactor mode) on a spare port
+// and keeps connections x window commands outstanding until `total` have
+// completed. The command is a cheap shell builtin-like program, so this
+// measures the client library plus the server's per-command overhead.
+//
+// Usage: ./bench_libclient [total] [command]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+#include "libclient.h"
+
+#define BENCH_PORT 5103
+
+static const char *g_cmd;
+static int g_total, g_submitted, g_done, g_failed;
+static size_t g_bytes;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void on_output(void *arg, int stream, const char *data, size_t len) {
+    (void)arg; (void)stream; (void)data;
+    g_bytes += len;
+}
+
+static void on_done(void *arg, const LcResult *res) {
+    LcClient *c = arg;
+    g_done++;
+    if (res->status != LC_OK || res->exit_code != 0) g_failed++;
+    // Closed loop: every completion frees a spot for the next command
+    if (g_submitted < g_total) {
+        g_submitted++;
+        lc_submit(c, g_cmd, on_output, on_done, c);
+    }
+}
+
+static pid_t start_server(const char *mode, uint16_t port) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        char portstr[8];
+        snprintf(portstr, sizeof(portstr), "%u", port);
+        execl("./server", "./server", "-m", mode, "--max-inflight=64", portstr, (char *)NULL);
+        _exit(127);
+    }
+    usleep(300 * 1000);  // let it bind
+    return pid;
+}
+
+static void run(uint16_t port, int conns, int window) {
+    LcConfig cfg = { .port = port, .connections = conns, .window = window };
+    LcClient *c = lc_create(&cfg);
+    if (!c) { fprintf(stderr, "lc_create failed\n"); exit(1); }
+
+    g_submitted = g_done = g_failed = 0;
+    g_bytes = 0;
+    int first = conns * window < g_total ? conns * window : g_total;
+
+    // Drive it the way an application would: lc_fd() in our own epoll set
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+    epoll_ctl(ep, EPOLL_CTL_ADD, lc_fd(c), &ev);
+
+    double t0 = now_sec();
+    for (int i = 0; i < first; i++) {
+        g_submitted++;
+        lc_submit(c, g_cmd, on_output, on_done, c);
+    }
+    while (g_done < g_total) {
+        struct epoll_event out;
+        if (epoll_wait(ep, &out, 1, 1000) <= 0) continue;
+        if (lc_process(c, 0) < 0) break;
+    }
+    double dt = now_sec() - t0;
+    printf("  %2d conns x %2d window  %8.0f cmds/s  (%d done, %d failed, %zu output bytes)\n",
+           conns, window, g_done / dt, g_done, g_failed, g_bytes);
+    close(ep);
+    lc_destroy(c);
+}
+
+int main(int argc, char **argv) {
+    g_total = argc > 1 ? atoi(argv[1]) : 2000;
+    g_cmd = argc > 2 ? argv[2] : "true";
+    if (g_total < 1) g_total = 1;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    static const int shapes[][2] = { { 1, 1 }, { 1, 16 }, { 4, 16 }, { 8, 64 } };
+    const char *modes[] = { "threads", "reactor" };
+    for (int m = 0; m < 2; m++) {
+        uint16_t port = BENCH_PORT + m;
+        pid_t srv = start_server(modes[m], port);
+        printf("%s mode, %d x \"%s\"\n", modes[m], g_total, g_cmd);
+        for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+            run(port, shapes[i][0], shapes[i][1]);
+        }
+        kill(srv, SIGTERM);
+        waitpid(srv, NULL, 0);
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+// bench_lz.c - output compression: bytes saved and CPU cost per frame size
+//
+// Compresses each corpus in frame-sized chunks, the way the frame writer
+// does, and checks that every chunk round-trips.
+//
+// Usage: ./bench_lz [file...]   (default: built-in log / listing / random corpora)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lz.h"
+
+#define CORPUS_SIZE (8 * 1024 * 1024)
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Server-log style lines: timestamps, levels, a few repeating messages
+static size_t gen_log(char *buf, size_t cap) {
+    static const char *lvl[] = { "INFO", "DEBUG", "WARN", "ERROR" };
+    static const char *msg[] = { "client connected", "job finished in %d ms",
+                                 "queue depth %d", "retrying request %d" };
+    size_t n = 0;
+    for (unsigned i = 0; n + 128 < cap; i++) {
+        char m[64];
+        snprintf(m, sizeof(m), msg[i % 4], (int)(rand() % 1000));
+        n += snprintf(buf + n, cap - n, "2024-05-%02u 12:%02u:%02u.%03u [%s] worker-%u: %s\n",
+                      1 + i / 86400 % 28, i / 60 % 60, i % 60, rand() % 1000,
+                      lvl[rand() % 4], rand() % 8, m);
+    }
+    return n;
+}
+
+// `ls -R` style listing: directory headers followed by file names
+static size_t gen_listing(char *buf, size_t cap) {
+    static const char *ext[] = { ".c", ".h", ".o", ".txt", ".log", "" };
+    size_t n = 0;
+    for (unsigned d = 0; n + 256 < cap; d++) {
+        n += snprintf(buf + n, cap - n, "\n./src/module_%u/sub_%u:\n", d / 10, d % 10);
+        for (int f = 0; f < 20 && n + 64 < cap; f++) {
+            n += snprintf(buf + n, cap - n, "file_%03d%s\n", rand() % 200, ext[rand() % 6]);
+        }
+    }
+    return n;
+}
+
+static size_t gen_random(char *buf, size_t cap) {
+    for (size_t i = 0; i < cap; i++) buf[i] = (char)rand();
+    return cap;
+}
+
+static size_t load_file(const char *path, char *buf, size_t cap) {
+    FILE *f = fopen(path, "rb");
+    if (!f) { perror(path); return 0; }
+    size_t n = fread(buf, 1, cap, f);
+    fclose(f);
+    return n;
+}
+
+static void run(const char *name, const char *data, size_t n, size_t chunk) {
+    char *z = malloc(lz_bound(chunk));
+    char *out = malloc(chunk);
+    size_t wire = 0, raw_frames = 0, frames = 0;
+    double tc = 0, td = 0;
+
+    for (size_t off = 0; off < n; off += chunk) {
+        size_t len = n - off < chunk ? n - off : chunk;
+        double t0 = now_sec();
+        size_t zl = lz_compress(data + off, len, z, len > 5 ? len - 5 : 0);
+        double t1 = now_sec();
+        tc += t1 - t0;
+        frames++;
+        if (zl == 0) {  // does not compress: the writer sends it raw
+            wire += len;
+            raw_frames++;
+            continue;
+        }
+        wire += zl + 4;  // + raw_len prefix
+        long dl = lz_decompress(z, zl, out, len);
+        td += now_sec() - t1;
+        if (dl != (long)len || memcmp(out, data + off, len) != 0) {
+            fprintf(stderr, "%s: round trip failed at offset %zu\n", name, off);
+            exit(1);
+        }
+    }
+    printf("%-10s %6zu B  saved %5.1f%%  raw frames %5.1f%%  comp %7.1f MB/s (%5.2f ns/B)  decomp %7.1f MB/s\n",
+           name, chunk, 100.0 * (1.0 - (double)wire / n), 100.0 * raw_frames / frames,
+           n / tc / 1e6, tc * 1e9 / n, td > 0 ? n / td / 1e6 : 0.0);
+    free(z);
+    free(out);
+}
+
+int main(int argc, char **argv) {
+    static const size_t chunks[] = { 1024, 16384, 65536 };
+    char *buf = malloc(CORPUS_SIZE);
+    if (!buf) return 1;
+    srand(1);
+
+    struct { const char *name; size_t (*gen)(char *, size_t); } corpora[] = {
+        { "log", gen_log }, { "listing", gen_listing }, { "random", gen_random },
+    };
+
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            size_t n = load_file(argv[i], buf, CORPUS_SIZE);
+            for (size_t c = 0; n && c < sizeof(chunks) / sizeof(chunks[0]); c++)
+                run(argv[i], buf, n, chunks[c]);
+        }
+    } else {
+        for (size_t i = 0; i < sizeof(corpora) / sizeof(corpora[0]); i++) {
+            size_t n = corpora[i].gen(buf, CORPUS_SIZE);
+            for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++)
+                run(corpora[i].name, buf, n, chunks[c]);
+        }
+    }
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,206 @@
+// bench_net.c - framing throughput over loopback TCP and a unix socket.
+//
+// Sweeps frame sizes from 16 B to 1 MB with [u32 len][payload] frames in
+// two patterns:
+//   stream  one side sends frames back to back, the other reads them (sink)
+//   echo    one frame out, the same frame back (round trips)
+// and reports frames/s, MB/s and syscalls per frame (both ends together;
+// read/write calls from /proc/thread-self/io plus io_uring_enter calls).
+//
+// Backends are a table of send/recv functions, so another I/O path only
+// needs a new entry:
+//   net    net.c writevn/readn, as in client.c's send_frame/recv_frame
+//   io     io.h with the plain backend, as the server's frame paths use
+//   uring  io.h with the io_uring backend (skipped if unavailable)
+//
+// Usage: ./bench_net [-t tcp|unix|all] [-b net,io,uring] [-m stream|echo|all]
+//                    [-d seconds_per_point]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "net.h"
+#include "io.h"
+
+#define BENCH_PORT 5104
+#define BENCH_UNIX "/tmp/bench_net.sock"
+#define MAX_FRAME (1024 * 1024)
+
+typedef struct {
+    const char *name;
+    bool (*select)(void);       // switch to this backend; false = unavailable
+    int (*send_frame)(int fd, const void *buf, uint32_t len);
+    ssize_t (*readn)(int fd, void *buf, size_t n);
+    bool counts_enter;          // io_syscalls() counts io_uring_enter calls
+} Backend;
+
+static bool select_net(void) { return io_set_backend(IO_BACKEND_NET) == IO_BACKEND_NET; }
+static bool select_uring(void) { return io_set_backend(IO_BACKEND_URING) == IO_BACKEND_URING; }
+
+static int net_send_frame(int fd, const void *buf, uint32_t len) {
+    uint32_t be = htonl(len);
+    struct iovec iov[2] = { { &be, 4 }, { (void *)buf, len } };
+    return writevn(fd, iov, len ? 2 : 1) < 0 ? -1 : 0;
+}
+
+static const Backend backends[] = {
+    { "net",   select_net,   net_send_frame, readn,     false },
+    { "io",    select_net,   io_send_frame,  io_readn,  false },
+    { "uring", select_uring, io_send_frame,  io_readn,  true },
+};
+#define NBACKENDS (sizeof(backends) / sizeof(backends[0]))
+
+static const Backend *g_be;
+static double g_seconds = 0.25;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// read + write syscalls issued by the calling thread so far
+static unsigned long thread_syscalls(void) {
+    FILE *f = fopen("/proc/thread-self/io", "r");
+    if (!f) return 0;
+    char key[32];
+    unsigned long v, n = 0;
+    while (fscanf(f, "%31[^:]: %lu\n", key, &v) == 2) {
+        if (strcmp(key, "syscr") == 0 || strcmp(key, "syscw") == 0) n += v;
+    }
+    fclose(f);
+    if (g_be->counts_enter) n += io_syscalls();
+    return n;
+}
+
+// Reads one frame; returns its length, or -1
+static long recv_frame(int fd, char *buf) {
+    uint32_t be;
+    if (g_be->readn(fd, &be, 4) != 4) return -1;
+    uint32_t len = ntohl(be);
+    if (len > MAX_FRAME) return -1;
+    if (len && g_be->readn(fd, buf, len) != (ssize_t)len) return -1;
+    return len;
+}
+
+typedef struct {
+    int fd;
+    bool echo;
+    unsigned long syscalls;
+} Peer;
+
+// Sink (stream) or echo side, until the empty end frame
+static void *peer_func(void *arg) {
+    Peer *p = arg;
+    g_be->select();
+    char *buf = malloc(MAX_FRAME);
+    unsigned long s0 = thread_syscalls();
+    long len;
+    while ((len = recv_frame(p->fd, buf)) > 0) {
+        if (p->echo && g_be->send_frame(p->fd, buf, (uint32_t)len) < 0) break;
+    }
+    p->syscalls = thread_syscalls() - s0;
+    free(buf);
+    return NULL;
+}
+
+static void connect_pair(bool use_unix, int *a, int *b) {
+    int lfd = use_unix ? unix_listen(BENCH_UNIX, 1) : tcp_listen(BENCH_PORT);
+    if (lfd < 0) { perror("listen"); exit(1); }
+    *a = use_unix ? unix_connect(BENCH_UNIX) : tcp_connect("127.0.0.1", BENCH_PORT);
+    *b = accept(lfd, NULL, NULL);
+    if (*a < 0 || *b < 0) { perror("connect"); exit(1); }
+    close(lfd);
+    if (!use_unix) {
+        int one = 1;
+        setsockopt(*a, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        setsockopt(*b, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+}
+
+static void run_point(bool use_unix, bool echo, uint32_t size) {
+    int a, b;
+    connect_pair(use_unix, &a, &b);
+    Peer peer = { .fd = b, .echo = echo };
+    pthread_t tid;
+    pthread_create(&tid, NULL, peer_func, &peer);
+
+    char *buf = malloc(MAX_FRAME);
+    memset(buf, 'x', size);
+    unsigned long frames = 0, s0 = thread_syscalls();
+    double t0 = now_sec(), dt;
+    for (;;) {
+        if (g_be->send_frame(a, buf, size) < 0) break;
+        if (echo && recv_frame(a, buf) != (long)size) break;
+        frames++;
+        // Check the clock every so often, not on every tiny frame
+        if ((frames & 63) == 0 || size >= 65536) {
+            if ((dt = now_sec() - t0) >= g_seconds) break;
+        }
+    }
+    g_be->send_frame(a, NULL, 0);
+    unsigned long sys = thread_syscalls() - s0;
+    pthread_join(tid, NULL);
+    dt = now_sec() - t0;  // a stream is done once the sink has everything
+    close(a);
+    close(b);
+    free(buf);
+
+    sys += peer.syscalls;
+    printf("  %8u B  %11.0f frames/s  %9.1f MB/s  %6.2f syscalls/frame\n", size, frames / dt,
+           frames * (double)size * (echo ? 2 : 1) / dt / 1e6, frames ? (double)sys / frames : 0.0);
+}
+
+static bool listed(const char *list, const char *name) {
+    if (strcmp(list, "all") == 0) return true;
+    size_t n = strlen(name);
+    for (const char *p = list; (p = strstr(p, name)); p += n) {
+        if ((p == list || p[-1] == ',') && (p[n] == ',' || p[n] == '\0')) return true;
+    }
+    return false;
+}
+
+int main(int argc, char **argv) {
+    const char *transports = "all", *bends = "all", *modes = "all";
+    int opt;
+    while ((opt = getopt(argc, argv, "t:b:m:d:")) != -1) {
+        switch (opt) {
+        case 't': transports = optarg; break;
+        case 'b': bends = optarg; break;
+        case 'm': modes = optarg; break;
+        case 'd': g_seconds = atof(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-t tcp|unix|all] [-b net,io,uring|all] "
+                            "[-m stream|echo|all] [-d seconds_per_point]\n", argv[0]);
+            return 1;
+        }
+    }
+    signal(SIGPIPE, SIG_IGN);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    static const char *tnames[] = { "tcp", "unix" };
+    static const char *mnames[] = { "stream", "echo" };
+    for (size_t bi = 0; bi < NBACKENDS; bi++) {
+        g_be = &backends[bi];
+        if (!listed(bends, g_be->name)) continue;
+        if (!g_be->select()) { printf("%s: unavailable, skipped\n", g_be->name); continue; }
+        for (int t = 0; t < 2; t++) {
+            if (!listed(transports, tnames[t])) continue;
+            for (int m = 0; m < 2; m++) {
+                if (!listed(modes, mnames[m])) continue;
+                printf("%s over %s, %s\n", g_be->name, tnames[t], mnames[m]);
+                for (uint32_t size = 16; size <= MAX_FRAME; size *= 4) run_point(t == 1, m == 1, size);
+            }
+        }
+    }
+    unlink(BENCH_UNIX);
+    return 0;
+}
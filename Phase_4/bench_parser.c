@@ -0,0 +1,241 @@
+// bench_parser.c - cost of turning a command line into pipeline stages:
+// parse_command + build_pipeline (which runs parse_redirs per stage).
+//
+// Runs a corpus of realistic command lines, grouped by what they exercise,
+// and reports ns/command, allocations/command and bytes allocated per
+// command. Allocations are counted by wrapping malloc & co. in this binary,
+// so glob(3)'s own allocations are included. Globs expand inside a scratch
+// directory with a fixed set of files, so results don't depend on the cwd.
+//
+// Usage: ./bench_parser [-n iterations] [--save FILE] [--compare FILE]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "utils.h"
+
+// ---------------------------------------------------------------------------
+// Allocation counting. Overriding malloc in the executable takes over every
+// allocation in the process (libc included); the real work is done by
+// glibc's __libc_* entry points.
+// ---------------------------------------------------------------------------
+
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+extern void __libc_free(void *);
+
+static int g_counting;
+static unsigned long g_allocs, g_bytes;
+
+void *malloc(size_t n) {
+    if (g_counting) { g_allocs++; g_bytes += n; }
+    return __libc_malloc(n);
+}
+
+void *calloc(size_t n, size_t size) {
+    if (g_counting) { g_allocs++; g_bytes += n * size; }
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t n) {
+    if (g_counting) { g_allocs++; g_bytes += n; }
+    return __libc_realloc(p, n);
+}
+
+void free(void *p) {
+    __libc_free(p);
+}
+
+// ---------------------------------------------------------------------------
+// Corpus
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const char *name;
+    const char *lines[8];
+} Group;
+
+static const Group corpus[] = {
+    { "simple", {
+        "ls -l",
+        "echo hello world",
+        "grep -n main server.c",
+        "./demo 5",
+        "wc -l notes.txt" } },
+    { "quotes", {
+        "echo 'single quoted string with spaces'",
+        "echo \"double quoted $HOME text\"",
+        "grep -e 'a b' -e \"c d\" notes.txt",
+        "printf '%s\\n' \"one two\" 'three four'" } },
+    { "escapes", {
+        "echo a\\ b\\ c",
+        "echo \"tab\\there\" \\\"quoted\\\"",
+        "touch file\\ with\\ spaces.txt",
+        "echo -e \"line1\\nline2\" back\\\\slash" } },
+    { "globs", {
+        "ls *.c",
+        "wc -l src_?.c",
+        "cat data_[0-4].txt",
+        "echo *.nomatch",
+        "ls '*.c' *.h" } },
+    { "pipes", {
+        "ls -l | wc -l",
+        "cat notes.txt | grep error | sort | uniq -c",
+        "ps aux | grep server | head -n 5",
+        "echo hi | tr a-z A-Z | rev" } },
+    { "redirections", {
+        "sort < notes.txt > sorted.txt",
+        "./demo 3 2> err.log",
+        "cat < in.txt > out.txt 2> err.txt",
+        "echo data > out.txt" } },
+    { "mixed", {
+        "cat *.txt | grep -v 'skip me' | sort -r > sorted.txt 2> err.log",
+        "grep \"a\\\"b\" src_*.c | wc -l > count.txt",
+        "find . -name '*.c' | xargs wc -l | sort -n | tail -n 3" } },
+};
+#define NGROUPS (sizeof(corpus) / sizeof(corpus[0]))
+
+typedef struct {
+    double ns, allocs, bytes;   // per command
+} Result;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// One full parse, freeing everything like a long-lived caller would have to
+static void parse_once(const char *line) {
+    char **tokens = parse_command(line);
+    // build_pipeline compacts argv in place and drops the redirection
+    // tokens, so keep the full list to free afterwards
+    char *all[64];
+    int n = 0;
+    while (tokens[n] && n < 64) { all[n] = tokens[n]; n++; }
+
+    Stage *stages;
+    int nstages;
+    const char *err;
+    if (build_pipeline(tokens, &stages, &nstages, &err) >= 0) free(stages);
+    for (int i = 0; i < n; i++) free(all[i]);
+    free(tokens);
+}
+
+static Result run_group(const Group *g, int iters) {
+    int nlines = 0;
+    while (nlines < 8 && g->lines[nlines]) nlines++;
+
+    for (int l = 0; l < nlines; l++) parse_once(g->lines[l]);  // warm up
+
+    g_allocs = g_bytes = 0;
+    g_counting = 1;
+    double t0 = now_ns();
+    for (int it = 0; it < iters; it++) {
+        for (int l = 0; l < nlines; l++) parse_once(g->lines[l]);
+    }
+    double dt = now_ns() - t0;
+    g_counting = 0;
+
+    double cmds = (double)iters * nlines;
+    return (Result){ dt / cmds, g_allocs / cmds, g_bytes / cmds };
+}
+
+// Scratch directory for the globs: src_0.c .. src_9.c, data_0.txt .. data_9.txt
+static char *make_scratch(void) {
+    static char dir[] = "/tmp/bench_parser.XXXXXX";
+    if (!mkdtemp(dir)) { perror("mkdtemp"); exit(1); }
+    char path[64];
+    for (int i = 0; i < 10; i++) {
+        snprintf(path, sizeof(path), "%s/src_%d.c", dir, i);
+        close(open(path, O_CREAT | O_WRONLY, 0644));
+        snprintf(path, sizeof(path), "%s/data_%d.txt", dir, i);
+        close(open(path, O_CREAT | O_WRONLY, 0644));
+    }
+    return dir;
+}
+
+static void remove_scratch(const char *dir) {
+    char path[64];
+    for (int i = 0; i < 10; i++) {
+        snprintf(path, sizeof(path), "%s/src_%d.c", dir, i);
+        unlink(path);
+        snprintf(path, sizeof(path), "%s/data_%d.txt", dir, i);
+        unlink(path);
+    }
+    rmdir(dir);
+}
+
+// Baseline file: one "name ns allocs bytes" line per group
+static int load_baseline(const char *file, Result *base, int *have) {
+    FILE *f = fopen(file, "r");
+    if (!f) { perror(file); return -1; }
+    char name[64];
+    Result r;
+    while (fscanf(f, "%63s %lf %lf %lf", name, &r.ns, &r.allocs, &r.bytes) == 4) {
+        for (size_t g = 0; g < NGROUPS; g++) {
+            if (strcmp(name, corpus[g].name) == 0) { base[g] = r; have[g] = 1; }
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+static double pct(double now, double before) {
+    return before > 0 ? (now - before) * 100.0 / before : 0;
+}
+
+int main(int argc, char **argv) {
+    int iters = 2000;
+    const char *save = NULL, *compare = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) iters = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) save = argv[++i];
+        else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) compare = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [-n iterations] [--save FILE] [--compare FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (iters < 1) iters = 1;
+
+    Result base[NGROUPS];
+    int have[NGROUPS] = { 0 };
+    if (compare && load_baseline(compare, base, have) < 0) return 1;
+
+    char *dir = make_scratch();
+    char cwd[4096];
+    if (!getcwd(cwd, sizeof(cwd)) || chdir(dir) < 0) { perror("chdir"); return 1; }
+
+    Result res[NGROUPS];
+    printf("%-13s %10s %12s %12s\n", "group", "ns/cmd", "allocs/cmd", "bytes/cmd");
+    for (size_t g = 0; g < NGROUPS; g++) {
+        res[g] = run_group(&corpus[g], iters);
+        printf("%-13s %10.0f %12.1f %12.0f", corpus[g].name, res[g].ns, res[g].allocs, res[g].bytes);
+        if (have[g]) {
+            printf("   vs baseline: %+6.1f%% time  %+6.1f%% allocs  %+6.1f%% bytes",
+                   pct(res[g].ns, base[g].ns), pct(res[g].allocs, base[g].allocs),
+                   pct(res[g].bytes, base[g].bytes));
+        }
+        printf("\n");
+    }
+
+    if (chdir(cwd) < 0) perror("chdir");
+    remove_scratch(dir);
+
+    if (save) {
+        FILE *f = fopen(save, "w");
+        if (!f) { perror(save); return 1; }
+        for (size_t g = 0; g < NGROUPS; g++) {
+            fprintf(f, "%s %.1f %.2f %.1f\n", corpus[g].name, res[g].ns, res[g].allocs, res[g].bytes);
+        }
+        fclose(f);
+        printf("baseline saved to %s\n", save);
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+// bench_sched.c - scheduler.c's queue operations at scale.
+//
+// Keeps N demo-style jobs queued (N from 10 to 100k) and runs the three
+// critical sections the server executes under sched_lock, in steady state:
+//   submit  admit_job() of a new job, with and without the work limit
+//           (submit+limit: the O(1) queued_work() check, then add_job();
+//           it should stay level with plain submit at every N)
+//   pick    get_next_job() on CPU 0
+//   finish  slice_done() of the job that was picked, now finished
+// For each it reports the caller's latency (lock + operation + unlock) and
+// the lock hold time, i.e. how long every other thread is shut out.
+// Filling the queue to N goes through add_job() too; its average is shown
+// as "fill".
+//
+// Usage: ./bench_sched [iterations] [max_jobs]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "scheduler.h"
+
+typedef struct {
+    double *lat, *hold;         // ns per operation
+    int n;
+} Samples;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void samples_init(Samples *s, int cap) {
+    s->lat = malloc(sizeof(double) * cap);
+    s->hold = malloc(sizeof(double) * cap);
+    s->n = 0;
+    if (!s->lat || !s->hold) { perror("malloc"); exit(1); }
+}
+
+static void samples_free(Samples *s) {
+    free(s->lat);
+    free(s->hold);
+}
+
+static void report(int njobs, const char *op, Samples *s) {
+    qsort(s->lat, s->n, sizeof(double), cmp_double);
+    qsort(s->hold, s->n, sizeof(double), cmp_double);
+    double sum = 0;
+    for (int i = 0; i < s->n; i++) sum += s->lat[i];
+    printf("%8d  %-14s %11.0f %11.0f %11.0f %11.0f %11.0f\n", njobs, op, sum / s->n,
+           s->lat[s->n / 2], s->lat[(int)(s->n * 0.99)], s->hold[s->n / 2],
+           s->hold[(int)(s->n * 0.99)]);
+}
+
+static void job_init(Job *j, int id) {
+    memset(j, 0, sizeof(*j));
+    j->id = id;
+    j->total_time = j->remaining_time = j->burst_prediction = 1 + rand() % 100;
+    j->status = JOB_WAITING;
+}
+
+// Empties the queue between population sizes
+static void drain(void) {
+    Job *j;
+    while ((j = get_next_job(0))) {
+        j->status = JOB_FINISHED;
+        slice_done(j);
+    }
+}
+
+static void run(int njobs, int iters) {
+    Job *jobs = malloc(sizeof(Job) * (njobs + iters));
+    if (!jobs) { perror("malloc"); exit(1); }
+    // Filling the queue is itself an add_job() per job; report the average
+    double t0 = now_ns();
+    for (int i = 0; i < njobs; i++) {
+        job_init(&jobs[i], i + 1);
+        add_job(&jobs[i]);
+    }
+    printf("%8d  %-14s %11.0f\n", njobs, "fill (add_job)", (now_ns() - t0) / njobs);
+
+    Samples submit, submit_lim, pick, finish;
+    samples_init(&submit, iters);
+    samples_init(&submit_lim, iters);
+    samples_init(&pick, iters);
+    samples_init(&finish, iters);
+
+    for (int it = 0; it < iters; it++) {
+        Job *j = &jobs[njobs + it];
+        job_init(j, njobs + it + 1);
+
+        // Every other submit runs with the work limit on (set high enough
+        // to always admit), so admit_job() also checks the queued work total
+        Samples *sub = (it & 1) ? &submit_lim : &submit;
+        sched_max_work = (it & 1) ? 1 << 30 : 0;
+
+        t0 = now_ns();
+        pthread_mutex_lock(&sched_lock);
+        double t1 = now_ns();
+        admit_job(j);
+        double t2 = now_ns();
+        pthread_mutex_unlock(&sched_lock);
+        double t3 = now_ns();
+        sub->lat[sub->n] = t3 - t0;
+        sub->hold[sub->n++] = t2 - t1;
+
+        t0 = now_ns();
+        pthread_mutex_lock(&sched_lock);
+        t1 = now_ns();
+        Job *next = get_next_job(0);
+        t2 = now_ns();
+        pthread_mutex_unlock(&sched_lock);
+        t3 = now_ns();
+        pick.lat[pick.n] = t3 - t0;
+        pick.hold[pick.n++] = t2 - t1;
+
+        // The picked job finishes, so the population stays at njobs
+        t0 = now_ns();
+        pthread_mutex_lock(&sched_lock);
+        t1 = now_ns();
+        next->status = JOB_FINISHED;
+        slice_done(next);
+        t2 = now_ns();
+        pthread_mutex_unlock(&sched_lock);
+        t3 = now_ns();
+        finish.lat[finish.n] = t3 - t0;
+        finish.hold[finish.n++] = t2 - t1;
+    }
+    sched_max_work = 0;
+
+    report(njobs, "submit", &submit);
+    report(njobs, "submit+limit", &submit_lim);
+    report(njobs, "pick", &pick);
+    report(njobs, "finish", &finish);
+    samples_free(&submit);
+    samples_free(&submit_lim);
+    samples_free(&pick);
+    samples_free(&finish);
+    drain();
+    free(jobs);
+}
+
+int main(int argc, char **argv) {
+    int iters = argc > 1 ? atoi(argv[1]) : 2000;
+    int max_jobs = argc > 2 ? atoi(argv[2]) : 100000;
+    if (iters < 2) iters = 2;
+
+    srand(1);
+    scheduler_init(1);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("%d operations per size; times in ns\n", iters);
+    printf("%8s  %-14s %11s %11s %11s %11s %11s\n", "jobs", "operation", "mean", "p50", "p99",
+           "hold p50", "hold p99");
+    for (int n = 10; n <= max_jobs; n *= 10) run(n, iters);
+    return 0;
+}
@@ -0,0 +1,119 @@
+// bench_splice.c - child-output streaming: 1 KB copy loop vs splice() frames
+//
+// A forked "child" writes the output into a pipe, like `cat bigfile` would;
+// the parent frames it onto a loopback TCP socket drained by a sink thread.
+//
+// Usage: ./bench_splice [total_GB] (default 2)
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <stdbool.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "net.h"
+#include "io.h"
+#include "frame.h"
+
+#define BENCH_PORT 5098
+#define PIPE_SIZE (1024 * 1024)
+
+static size_t g_total;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *sink(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    static char buf[1 << 18];
+    while (read(fd, buf, sizeof(buf)) > 0) {}
+    close(fd);
+    return NULL;
+}
+
+static pid_t spawn_producer(int wfd) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        static char buf[65536];
+        memset(buf, 'x', sizeof(buf));
+        size_t left = g_total;
+        while (left > 0) {
+            size_t n = left < sizeof(buf) ? left : sizeof(buf);
+            if (writen(wfd, buf, n) < 0) break;
+            left -= n;
+        }
+        _exit(0);
+    }
+    return pid;
+}
+
+static void run(const char *name, bool zero_copy, int lfd) {
+    int cfd = tcp_connect("127.0.0.1", BENCH_PORT);
+    int sfd = accept(lfd, NULL, NULL);
+    int pfd[2];
+    if (cfd < 0 || sfd < 0 || pipe(pfd) < 0) { perror("setup"); exit(1); }
+    if (zero_copy) fcntl(pfd[0], F_SETPIPE_SZ, PIPE_SIZE);
+
+    pthread_t st;
+    pthread_create(&st, NULL, sink, (void *)(intptr_t)cfd);
+
+    FrameWriter fw;
+    fw_init(&fw, sfd);
+    unsigned long frames = 0;
+
+    double t0 = now_sec();
+    pid_t pid = spawn_producer(pfd[1]);
+    close(pfd[1]);
+
+    if (zero_copy) {
+        while (fw_splice_frame(&fw, 0, FT_STDOUT, pfd[0], PIPE_SIZE) > 0) frames++;
+    } else {
+        // Same shape as stream_shell_output in server.c
+        char buf[2][1024];
+        int cur = 0;
+        ssize_t r = io_read(pfd[0], buf[cur], sizeof(buf[cur]));
+        while (r > 0) {
+            ssize_t next = fw_send_and_read(&fw, 0, buf[cur], (uint32_t)r,
+                                               pfd[0], buf[cur ^ 1], sizeof(buf[cur ^ 1]));
+            frames++;
+            cur ^= 1;
+            r = next;
+        }
+    }
+    fw_send(&fw, NULL, 0);
+    fw_flush(&fw);
+    double dt = now_sec() - t0;
+
+    waitpid(pid, NULL, 0);
+    close(pfd[0]);
+    shutdown(sfd, SHUT_WR);
+    pthread_join(st, NULL);
+    close(sfd);
+    fw_destroy(&fw);
+
+    printf("%-10s %8.1f MB/s  %10lu frames  %8.1f KB/frame  %6.2f s\n",
+           name, g_total / dt / 1e6, frames, g_total / 1024.0 / (frames ? frames : 1), dt);
+}
+
+int main(int argc, char **argv) {
+    signal(SIGPIPE, SIG_IGN);
+    double gb = argc > 1 ? atof(argv[1]) : 2.0;
+    g_total = (size_t)(gb * 1024 * 1024 * 1024);
+
+    int lfd = tcp_listen(BENCH_PORT);
+    if (lfd < 0) { perror("listen"); return 1; }
+
+    printf("child pipe -> framed loopback TCP, %.2f GB\n", gb);
+    run("copy-1KB", false, lfd);
+    run("splice", true, lfd);
+    close(lfd);
+    return 0;
+}
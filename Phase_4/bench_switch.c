@@ -0,0 +1,156 @@
+// bench_switch.c - quantum-switch latency with and without --affinity
+//
+// Forks J "jobs" that each own a working set of W KB. Like the scheduler,
+// the parent resumes one job at a time (SIGCONT), hands it a token, waits
+// for it to walk its working set once and answer, then stops it (SIGSTOP).
+// The time from SIGCONT to the answer is the switch latency plus one pass
+// over a cache that may or may not still be warm. Placements:
+//   float     nothing pinned, the kernel picks cores
+//   pinned    the server's mapping with --affinity=<first core> --cpus=C:
+//             parent on the first allowed core, job i on scheduler CPU
+//             i % C and so on that CPU's worker core (affinity_core())
+//   migrate   pinned, but every job moves to the next worker core on each
+//             resume - the worst case that staying put avoids
+// With the server's default --cpus=1 every job shares one worker core.
+//
+// Usage: ./bench_switch [rounds] [working_set_kb] [jobs] [cpus]
+//        (default 2000 256 4 1)
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/wait.h>
+#include "affinity.h"
+
+typedef enum { PLACE_FLOAT, PLACE_PINNED, PLACE_MIGRATE } Placement;
+
+typedef struct {
+    pid_t pid;
+    int to, from;               // token pipe in, answer pipe out (parent side)
+} BenchJob;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// The job: one pass over its working set per token
+static void job_main(int in, int out, size_t ws) {
+    volatile unsigned char *mem = malloc(ws);
+    if (!mem) exit(1);
+    for (size_t i = 0; i < ws; i++) mem[i] = (unsigned char)i;
+    char tok;
+    while (read(in, &tok, 1) == 1) {
+        unsigned sum = 0;
+        for (size_t i = 0; i < ws; i += 64) sum += mem[i]++;
+        tok = (char)sum;
+        if (write(out, &tok, 1) != 1) break;
+    }
+    exit(0);
+}
+
+static int spawn(BenchJob *j, size_t ws, int core) {
+    int to[2], from[2];
+    if (pipe(to) < 0 || pipe(from) < 0) return -1;
+    j->pid = fork();
+    if (j->pid < 0) return -1;
+    if (j->pid == 0) {
+        affinity_pin_pid(0, core);
+        close(to[1]);
+        close(from[0]);
+        job_main(to[0], from[1], ws);
+    }
+    close(to[0]);
+    close(from[1]);
+    j->to = to[1];
+    j->from = from[0];
+    return 0;
+}
+
+static void run(Placement place, const char *name, int rounds, size_t ws, int njobs,
+                int ncpus) {
+    BenchJob *jobs = calloc(njobs, sizeof(BenchJob));
+    double *lat = malloc(sizeof(double) * rounds * njobs);
+    if (!jobs || !lat) { perror("malloc"); exit(1); }
+
+    cpu_set_t saved;
+    sched_getaffinity(0, sizeof(saved), &saved);
+    if (place != PLACE_FLOAT) affinity_pin_control();
+
+    for (int i = 0; i < njobs; i++) {
+        int core = place == PLACE_FLOAT ? -1 : affinity_core(i % ncpus);
+        if (spawn(&jobs[i], ws, core) < 0) { perror("spawn"); exit(1); }
+        // Warm up once, then stop it like a preempted job
+        char tok = 0;
+        if (write(jobs[i].to, &tok, 1) != 1 || read(jobs[i].from, &tok, 1) != 1) exit(1);
+        kill(jobs[i].pid, SIGSTOP);
+    }
+
+    int n = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < njobs; i++) {
+            BenchJob *j = &jobs[i];
+            if (place == PLACE_MIGRATE) affinity_pin_pid(j->pid, affinity_core(i % ncpus + r + 1));
+            char tok = 0;
+            double t0 = now_us();
+            kill(j->pid, SIGCONT);
+            if (write(j->to, &tok, 1) != 1 || read(j->from, &tok, 1) != 1) exit(1);
+            lat[n++] = now_us() - t0;
+            kill(j->pid, SIGSTOP);
+        }
+    }
+
+    // Later children hold copies of earlier pipes, so no EOF: just kill
+    for (int i = 0; i < njobs; i++) {
+        kill(jobs[i].pid, SIGKILL);
+        waitpid(jobs[i].pid, NULL, 0);
+        close(jobs[i].to);
+        close(jobs[i].from);
+    }
+    sched_setaffinity(0, sizeof(saved), &saved);
+
+    qsort(lat, n, sizeof(double), cmp_double);
+    double sum = 0;
+    for (int i = 0; i < n; i++) sum += lat[i];
+    printf("%-8s %10.1f %10.1f %10.1f\n", name, sum / n, lat[n / 2], lat[(int)(n * 0.99)]);
+    free(lat);
+    free(jobs);
+}
+
+int main(int argc, char **argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 2000;
+    size_t ws = (size_t)(argc > 2 ? atoi(argv[2]) : 256) * 1024;
+    int njobs = argc > 3 ? atoi(argv[3]) : 4;
+    int ncpus = argc > 4 ? atoi(argv[4]) : 1;
+    if (rounds < 1 || ws < 64 || njobs < 1 || ncpus < 1) {
+        fprintf(stderr, "Usage: %s [rounds] [working_set_kb] [jobs] [cpus]\n", argv[0]);
+        return 1;
+    }
+
+    // The first allowed core is the control core, the rest are workers
+    cpu_set_t allowed;
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    int first = 0;
+    while (!CPU_ISSET(first, &allowed)) first++;
+    char control[16];
+    snprintf(control, sizeof(control), "%d", first);
+    if (affinity_init(control) < 0) { fprintf(stderr, "affinity_init failed\n"); return 1; }
+
+    printf("%d jobs x %d rounds, %zu KB working set, %d scheduler CPU(s), %d worker core(s); "
+           "times in us\n", njobs, rounds, ws / 1024, ncpus, affinity_workers());
+    printf("%-8s %10s %10s %10s\n", "place", "mean", "p50", "p99");
+    run(PLACE_FLOAT, "float", rounds, ws, njobs, ncpus);
+    run(PLACE_PINNED, "pinned", rounds, ws, njobs, ncpus);
+    run(PLACE_MIGRATE, "migrate", rounds, ws, njobs, ncpus);
+    return 0;
+}
@@ -3,26 +3,117 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
 #include <unistd.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
 #include "net.h"
+#include "lz.h"
+#include "wire.h"
 
 static int send_frame(int fd, const char *buf, uint32_t len) {
     uint32_t be = htonl(len);
-    if (writen(fd, &be, 4) != 4) return -1;
-    if (len && writen(fd, buf, len) != (ssize_t)len) return -1;
+    // header + payload in one writev, so Nagle never holds back the payload
+    struct iovec iov[2] = { { &be, 4 }, { (void *)buf, len } };
+    if (writevn(fd, iov, len ? 2 : 1) < 0) return -1;
     return 0;
 }
 
-static int recv_frame(int fd, char **buf, uint32_t *len) {
+// ---------------------------------------------------------------------------
+// Receive path: frames are parsed straight out of one growable buffer and
+// handed out as views, valid until the next recv. Stdout payloads are
+// queued as iovecs pointing into that buffer and written with one writev,
+// so streaming output costs no allocation or copy per frame.
+// ---------------------------------------------------------------------------
+
+#define RECV_BUF_INIT (256 * 1024)
+#define OUT_IOV_MAX 64
+
+typedef struct {
+    int fd;
+    char *buf;
+    size_t cap, start, end;     // unparsed bytes are buf[start, end)
+    char *zbuf;                 // decompressed payload of the last frame
+    size_t zcap;
+} RecvBuf;
+
+typedef struct {
+    struct iovec iov[OUT_IOV_MAX];
+    int n;
+    size_t bytes;
+    size_t flush_bytes;         // write once this much is queued (0 = every frame)
+} OutQueue;
+
+static RecvBuf g_rb;
+static OutQueue g_out;
+
+static void out_flush(OutQueue *o) {
+    if (o->n == 0) return;
+    (void)writevn(STDOUT_FILENO, o->iov, o->n);
+    o->n = 0;
+    o->bytes = 0;
+}
+
+// Queues `data` for stdout. It must stay put until the next out_flush().
+static void out_add(OutQueue *o, const char *data, size_t len) {
+    if (len == 0) return;
+    o->iov[o->n].iov_base = (void *)data;
+    o->iov[o->n].iov_len = len;
+    o->n++;
+    o->bytes += len;
+    if (o->n == OUT_IOV_MAX || o->bytes >= o->flush_bytes) out_flush(o);
+}
+
+static void rb_init(RecvBuf *rb, int fd) {
+    memset(rb, 0, sizeof(*rb));
+    rb->fd = fd;
+    rb->cap = RECV_BUF_INIT;
+    rb->buf = malloc(rb->cap);
+    if (!rb->buf) { perror("malloc"); exit(1); }
+}
+
+// Makes sure at least `n` unparsed bytes are buffered
+static int rb_need(RecvBuf *rb, size_t n) {
+    // Nothing left to parse and nothing queued points in here: start over
+    if (rb->start == rb->end && g_out.n == 0) rb->start = rb->end = 0;
+    while (rb->end - rb->start < n) {
+        if (rb->start + n > rb->cap) {
+            // Bytes are about to move, so write out what still points at them
+            out_flush(&g_out);
+            size_t have = rb->end - rb->start;
+            memmove(rb->buf, rb->buf + rb->start, have);
+            rb->start = 0;
+            rb->end = have;
+            if (n > rb->cap) {
+                size_t cap = rb->cap * 2 > n ? rb->cap * 2 : n;
+                char *nb = realloc(rb->buf, cap);
+                if (!nb) return -1;
+                rb->buf = nb;
+                rb->cap = cap;
+            }
+        }
+        ssize_t r = read(rb->fd, rb->buf + rb->end, rb->cap - rb->end);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        rb->end += (size_t)r;
+    }
+    return 0;
+}
+
+// v1 frame. *buf points into the receive buffer (not NUL-terminated).
+static int recv_frame(RecvBuf *rb, char **buf, uint32_t *len) {
     uint32_t be;
-    if (readn(fd, &be, 4) != 4)
+    if (rb_need(rb, 4) < 0)
         return -1;
+    memcpy(&be, rb->buf + rb->start, 4);
 
     uint32_t val = ntohl(be);
 
     // 🔸 Check for special control frame (server wants to close)
     if (val == 0xFFFFFFFF) {
+        rb->start += 4;
         *buf = NULL;
         *len = 0;
         return 1;  // signal "session closed"
@@ -30,30 +121,350 @@ static int recv_frame(int fd, char **buf, uint32_t *len) {
 
     *len = val;
     *buf = NULL;
+    if (rb_need(rb, 4 + (size_t)val) < 0)
+        return -1;
+    rb->start += 4;
 
     if (*len == 0)
         return 0;  // valid empty payload (e.g., command had no output)
 
-    *buf = malloc(*len + 1);
-    if (!*buf)
-        return -1;
+    *buf = rb->buf + rb->start;
+    rb->start += val;
+    return 0;
+}
 
-    if (readn(fd, *buf, *len) != (ssize_t)*len) {
-        free(*buf);
-        *buf = NULL;
-        return -1;
+// ---------------------------------------------------------------------------
+// Protocol v2 (negotiated on connect): every frame carries a request id and
+// a type, so stderr, the exit status and the server's timing trailer arrive
+// separately from stdout. See wire.h for the layout.
+// ---------------------------------------------------------------------------
+
+#define PIPELINE_WINDOW 16
+
+static int send_cmd(int fd, uint32_t req_id, const char *buf, uint32_t len) {
+    char hdr[FRAME_V2_HDR];
+    frame_encode_hdr(FRAME_V2, req_id, FT_CMD, 0, len, hdr);
+    struct iovec iov[2] = { { hdr, FRAME_V2_HDR }, { (void *)buf, len } };
+    if (writevn(fd, iov, len ? 2 : 1) < 0) return -1;
+    return 0;
+}
+
+// Local mode (-l, unix socket only): hands our stdout and stderr to the
+// server, whose jobs then write to them directly. Only exit status and
+// timing come back as frames.
+static int send_local_fds(int fd) {
+    char frame[FRAME_V2_HDR + 4];
+    frame_encode_hdr(FRAME_V2, 0, FT_CMD, 0, 4, frame);
+    memcpy(frame + FRAME_V2_HDR, "\0FDS", 4);
+    int fds[2] = { STDOUT_FILENO, STDERR_FILENO };
+    return send_fds(fd, frame, sizeof(frame), fds, 2) < 0 ? -1 : 0;
+}
+
+// v2 frame; compressed payloads are inflated into rb->zbuf. *buf points
+// into the receive state and is valid until the next recv.
+static int recv_v2(RecvBuf *rb, uint32_t *req_id, int *type, char **buf, uint32_t *len) {
+    if (rb_need(rb, FRAME_V2_HDR) < 0) return -1;
+    FrameHdr h;
+    frame_decode_hdr(FRAME_V2, rb->buf + rb->start, &h);
+    *len = h.len;
+    *req_id = h.req_id;
+    *type = h.type;
+    bool compressed = h.flags & FF_COMPRESSED;
+    *buf = NULL;
+    if (rb_need(rb, FRAME_V2_HDR + (size_t)*len) < 0) return -1;
+    *buf = rb->buf + rb->start + FRAME_V2_HDR;
+    rb->start += FRAME_V2_HDR + *len;
+    if (*len == 0) { *buf = NULL; return 0; }
+
+    if (compressed) {
+        // [u32 raw_len][lz block]: hand back the original bytes
+        if (*len < 4) return -1;
+        uint32_t raw = wire_get_u32(*buf);
+        if (raw > FRAME_MAX_RAW) return -1;
+        out_flush(&g_out);  // may still point at the last inflated frame
+        if (raw > rb->zcap) {
+            char *nz = realloc(rb->zbuf, raw);
+            if (!nz) return -1;
+            rb->zbuf = nz;
+            rb->zcap = raw;
+        }
+        if (lz_decompress(*buf + 4, *len - 4, rb->zbuf, raw) != (long)raw) return -1;
+        *buf = rb->zbuf;
+        *len = raw;
     }
+    return 0;
+}
+
+// Asks for protocol v2 with compressed output ("lz"; the server decides
+// per frame). Returns the version the server agreed to (1 or 2), or 0 if
+// the server turned the connection away (too many clients).
+static int negotiate(int fd, bool compress) {
+    const char *hello = compress ? "\0HELLO 2 lz" : "\0HELLO 2";
+    if (send_frame(fd, hello, 1 + (uint32_t)strlen(hello + 1)) < 0) return 1;
+    char *reply = NULL;
+    uint32_t len = 0;
+    if (recv_frame(&g_rb, &reply, &len) != 0) return 1;
+    int version = 1;
+    if (reply && len > 7 && memcmp(reply, "\0HELLO ", 7) == 0) {
+        char ver[16];
+        uint32_t n = len - 7 < sizeof(ver) - 1 ? len - 7 : sizeof(ver) - 1;
+        memcpy(ver, reply + 7, n);
+        ver[n] = '\0';
+        version = atoi(ver);
+    } else if (reply && len >= 4 && memcmp(reply, "busy", 4) == 0) {
+        fwrite(reply, 1, len, stderr);
+        return 0;
+    } else {
+        // An old server treats the hello as a command: skip to its end frame
+        while (len != 0) {
+            if (recv_frame(&g_rb, &reply, &len) != 0) break;
+        }
+    }
+    return version >= 2 ? 2 : 1;
+}
 
-    (*buf)[*len] = '\0';
+// Output, exit status and timing of one command
+typedef struct {
+    uint32_t req_id;
+    char *out, *err;    // output that arrived before it was this one's turn
+    size_t out_len, out_cap, err_len, err_cap;
+    int exit_code;
+    uint64_t timing[3]; // queue wait, run, turnaround (us)
+    bool has_timing;
+    bool done;
+} Pending;
+
+static bool g_show_timing;  // -t
+
+static int buf_append(char **b, size_t *len, size_t *cap, const char *data, size_t n) {
+    if (*len + n > *cap) {
+        size_t ncap = (*len + n) * 2;
+        char *nb = realloc(*b, ncap);
+        if (!nb) return -1;
+        *b = nb;
+        *cap = ncap;
+    }
+    memcpy(*b + *len, data, n);
+    *len += n;
+    return 0;
+}
+
+// Applies one frame to its command. `live` = print output right away.
+// Returns -1 if output to hold back could not be buffered.
+static int pending_frame(Pending *p, int type, const char *data, uint32_t len, bool live) {
+    switch (type) {
+    case FT_STDOUT:
+        if (live) out_add(&g_out, data, len);
+        else if (buf_append(&p->out, &p->out_len, &p->out_cap, data, len) < 0) return -1;
+        break;
+    case FT_STDERR:
+        if (live) { out_flush(&g_out); fwrite(data, 1, len, stderr); fflush(stderr); }
+        else if (buf_append(&p->err, &p->err_len, &p->err_cap, data, len) < 0) return -1;
+        break;
+    case FT_EXIT:
+        if (len >= 4) p->exit_code = (int)wire_get_u32(data);
+        break;
+    case FT_TIMING:
+        if (len >= FRAME_TIMING_SIZE) {
+            for (int i = 0; i < 3; i++) p->timing[i] = wire_get_u64(data + 8 * i);
+            p->has_timing = true;
+        }
+        break;
+    case FT_END:
+        p->done = true;
+        break;
+    case FT_BUSY:
+        // Not queued: the server is overloaded
+        if (len >= 4) fprintf(stderr, "busy, retry after %u ms\n", wire_get_u32(data));
+        p->exit_code = -1;
+        break;
+    }
+    return 0;
+}
+
+// Prints whatever was buffered, then the trailer if -t was given. Also the
+// end of a command, so queued stdout goes out here whatever the policy.
+static void pending_release(Pending *p) {
+    out_add(&g_out, p->out, p->out_len);
+    out_flush(&g_out);  // p->out is reused as soon as we return
+    if (p->err_len) { fwrite(p->err, 1, p->err_len, stderr); fflush(stderr); }
+    p->out_len = p->err_len = 0;
+    if (p->done && g_show_timing) {
+        if (p->has_timing) {
+            fprintf(stderr, "[exit %d | queue %.3f ms | run %.3f ms | total %.3f ms]\n", p->exit_code,
+                    p->timing[0] / 1e3, p->timing[1] / 1e3, p->timing[2] / 1e3);
+        } else {
+            fprintf(stderr, "[exit %d]\n", p->exit_code);
+        }
+    }
+}
+
+static void pending_reset(Pending *p, uint32_t req_id) {
+    p->req_id = req_id;
+    p->out_len = p->err_len = 0;
+    p->exit_code = 0;
+    p->has_timing = false;
+    p->done = false;
+}
+
+// Sends every stdin line as soon as the window allows; output is still
+// printed in submission order (-p).
+static int run_pipelined(int fd) {
+    Pending win[PIPELINE_WINDOW];
+    int head = 0, count = 0;
+    uint32_t next_id = 1;
+    bool input_done = false;
+    char *line = NULL; size_t cap = 0;
+
+    memset(win, 0, sizeof(win));
+    while (!input_done || count > 0) {
+        // Keep the window full
+        while (!input_done && count < PIPELINE_WINDOW) {
+            ssize_t r = getline(&line, &cap, stdin);
+            if (r == -1 || strcmp(line, "exit\n") == 0 || strcmp(line, "exit") == 0) {
+                input_done = true;
+                break;
+            }
+            Pending *p = &win[(head + count) % PIPELINE_WINDOW];
+            pending_reset(p, next_id++);
+            if (send_cmd(fd, p->req_id, line, (uint32_t)r) < 0) {
+                fprintf(stderr, "send error\n");
+                input_done = true;
+                break;
+            }
+            count++;
+        }
+        if (count == 0) break;
+
+        char *out; uint32_t olen, id; int type;
+        if (recv_v2(&g_rb, &id, &type, &out, &olen) < 0) { fprintf(stderr, "recv error\n"); break; }
+
+        int i;
+        for (i = 0; i < count; i++) {
+            if (win[(head + i) % PIPELINE_WINDOW].req_id == id) break;
+        }
+        if (i < count && pending_frame(&win[(head + i) % PIPELINE_WINDOW], type, out, olen, i == 0) < 0) {
+            fprintf(stderr, "out of memory\n");
+            break;
+        }
+
+        // Retire finished commands in order, releasing buffered output
+        while (count > 0 && win[head].done) {
+            pending_release(&win[head]);
+            head = (head + 1) % PIPELINE_WINDOW;
+            count--;
+            // The new head's buffered output can go out now; if it is done
+            // already, the next iteration releases it (trailer included)
+            if (count > 0 && !win[head].done) pending_release(&win[head]);
+        }
+    }
+
+    out_flush(&g_out);
+    send_cmd(fd, next_id, "exit", 4);
+    for (int i = 0; i < PIPELINE_WINDOW; i++) { free(win[i].out); free(win[i].err); }
+    free(line);
+    close(fd);
+    return 0;
+}
+
+// -S: sends a "\0STATS" control frame and prints the reply
+static int run_stats(int fd, int version) {
+    static const char req[] = "\0STATS";
+    int rc = version == 2 ? send_cmd(fd, 1, req, sizeof(req) - 1)
+                          : send_frame(fd, req, sizeof(req) - 1);
+    while (rc == 0) {
+        char *out; uint32_t olen, id; int type = FT_STDOUT;
+        rc = version == 2 ? recv_v2(&g_rb, &id, &type, &out, &olen) : recv_frame(&g_rb, &out, &olen);
+        if (rc != 0 || olen == 0) break;
+        if (type == FT_STDOUT) out_add(&g_out, out, olen);
+    }
+    out_flush(&g_out);
+    close(fd);
+    return rc == 0 ? 0 : 1;
+}
+
+// Interactive v2 loop: one command at a time, like the v1 loop below
+static int run_v2(int fd) {
+    char *line = NULL; size_t cap = 0;
+    uint32_t next_id = 1;
+    Pending p;
+    memset(&p, 0, sizeof(p));
+    for (;;) {
+        printf("$ "); fflush(stdout);
+        ssize_t r = getline(&line, &cap, stdin);
+        if (r == -1) break;
+
+        pending_reset(&p, next_id++);
+        if (send_cmd(fd, p.req_id, line, (uint32_t)r) < 0) { fprintf(stderr, "send error\n"); break; }
+
+        // "exit" makes the server hang up, which ends this loop
+        while (!p.done) {
+            char *out; uint32_t olen, id; int type;
+            if (recv_v2(&g_rb, &id, &type, &out, &olen) < 0) {
+                out_flush(&g_out);
+                fprintf(stderr, "recv error\n");
+                free(line);
+                close(fd);
+                return 0;
+            }
+            if (id == p.req_id) pending_frame(&p, type, out, olen, true);  // live: never buffers
+        }
+        pending_release(&p);
+    }
+    free(line);
+    close(fd);
     return 0;
 }
 
 int main(int argc, char **argv) {
     const char *host = "127.0.0.1";  // default host
     uint16_t port = 5050;            // default port
+    const char *unix_path = NULL;
+    bool pipelined = false, compress = true, local = false, stats = false;
+    const char *flush = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "ptus:lSf:")) != -1) {
+        switch (opt) {
+        case 'p': pipelined = true; break;      // several commands in flight
+        case 't': g_show_timing = true; break;  // exit status + server timing
+        case 'u': compress = false; break;      // don't ask for compressed output
+        case 's': unix_path = optarg; break;    // connect to the server's unix socket
+        case 'l': local = true; break;          // jobs write to our stdout directly
+        case 'S': stats = true; break;          // print server load counters and exit
+        case 'f': flush = optarg; break;        // stdout flush policy
+        default:
+            fprintf(stderr, "Usage: %s [-p] [-t] [-u] [-S] [-f frame|command|BYTES] "
+                            "[-s socket_path [-l]]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (local && (!unix_path || pipelined)) {
+        // fds only travel over unix sockets, and pipelined output would interleave
+        fprintf(stderr, "-l needs -s and cannot be combined with -p; ignoring it\n");
+        local = false;
+    }
 
-    int fd = tcp_connect(host, port);
+    // Output written as it arrives on a terminal, per command otherwise
+    if (!flush) g_out.flush_bytes = isatty(STDOUT_FILENO) ? 0 : SIZE_MAX;
+    else if (strcmp(flush, "frame") == 0) g_out.flush_bytes = 0;
+    else if (strcmp(flush, "command") == 0) g_out.flush_bytes = SIZE_MAX;
+    else g_out.flush_bytes = (size_t)atol(flush);
+
+    int fd = unix_path ? unix_connect(unix_path) : tcp_connect(host, port);
     if (fd < 0) { perror("connect"); return 1; }
+    rb_init(&g_rb, fd);
+    int one = 1;
+    if (!unix_path) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    int version = negotiate(fd, compress && !unix_path);  // compression buys nothing locally
+    if (version == 0) { close(fd); return 2; }
+    if (stats) return run_stats(fd, version);
+    if (version == 2) {
+        if (local && send_local_fds(fd) < 0) { perror("send_fds"); return 1; }
+        return pipelined ? run_pipelined(fd) : run_v2(fd);
+    }
+    if (pipelined) fprintf(stderr, "server does not support pipelining, running one command at a time\n");
 
     char *line = NULL; size_t cap = 0;
     for (;;) {
@@ -67,15 +478,17 @@ int main(int argc, char **argv) {
         while (1) {
             char *out = NULL; 
             uint32_t olen = 0;
-            int rf = recv_frame(fd, &out, &olen);
+            int rf = recv_frame(&g_rb, &out, &olen);
 
             if (rf < 0) {
+                out_flush(&g_out);
                 fprintf(stderr, "recv error\n");
                 free(line);
                 close(fd);
                 return 0;
             }
             if (rf == 1) { // Server closed session
+                out_flush(&g_out);
                 free(line);
                 close(fd);
                 return 0;
@@ -83,14 +496,12 @@ int main(int argc, char **argv) {
             
             // LENGTH 0 signals END OF COMMAND in our protocol
             if (olen == 0) {
-                free(out);
+                out_flush(&g_out);
                 break; 
             }
 
-            // Print chunk and flush immediately
-            fwrite(out, 1, olen, stdout);
-            fflush(stdout); 
-            free(out);
+            // Queue the chunk; the flush policy decides when it is written
+            out_add(&g_out, out, olen);
         }
     }
     free(line);
@@ -0,0 +1,382 @@
+// frame.c - length-prefixed frame writer
+#define _GNU_SOURCE
+#include "frame.h"
+#include "io.h"
+#include "lz.h"
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+static FwMode g_mode = FW_LATENCY;
+static size_t g_max_bytes = 16384;
+static unsigned g_max_delay_us = 2000;
+static size_t g_compress_min = 512;
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+void fw_configure(FwMode mode, size_t max_bytes, unsigned max_delay_us) {
+    g_mode = mode;
+    if (max_bytes > 0) g_max_bytes = max_bytes;
+    g_max_delay_us = max_delay_us;
+}
+
+FwMode fw_mode(void) { return g_mode; }
+
+void fw_set_compress_min(size_t bytes) { g_compress_min = bytes; }
+size_t fw_compress_min(void) { return g_compress_min; }
+
+void fw_init(FrameWriter *w, int fd) {
+    memset(w, 0, sizeof(*w));
+    w->fd = fd;
+    w->fmt = FRAME_V1;
+    w->out_fds[0] = w->out_fds[1] = -1;
+    pthread_mutex_init(&w->lock, NULL);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // fails harmlessly on non-TCP
+}
+
+void fw_destroy(FrameWriter *w) {
+    free(w->buf);
+    free(w->zbuf);
+    w->buf = w->zbuf = NULL;
+    for (int i = 0; i < 2; i++) {
+        if (w->out_fds[i] >= 0) close(w->out_fds[i]);
+        w->out_fds[i] = -1;
+    }
+    w->len = w->cap = 0;
+    pthread_mutex_destroy(&w->lock);
+}
+
+// Writes pending bytes plus (optionally) one more frame in a single writev.
+// Caller holds w->lock.
+static int write_out(FrameWriter *w, const char *hdr, size_t hlen,
+                     const void *buf, uint32_t len) {
+    struct iovec iov[3];
+    int n = 0;
+    if (w->len) iov[n++] = (struct iovec){ w->buf, w->len };
+    if (hdr) {
+        iov[n++] = (struct iovec){ (void *)hdr, hlen };
+        if (len) iov[n++] = (struct iovec){ (void *)buf, len };
+    }
+    w->len = 0;
+    if (n == 0) return 0;
+    if (io_writev_all(w->fd, iov, n) < 0) { w->err = -1; return -1; }
+    return 0;
+}
+
+static int flush_locked(FrameWriter *w) {
+    if (w->err) { w->len = 0; return -1; }
+    return write_out(w, NULL, 0, NULL, 0);
+}
+
+int fw_flush(FrameWriter *w) {
+    pthread_mutex_lock(&w->lock);
+    int rc = flush_locked(w);
+    pthread_mutex_unlock(&w->lock);
+    return rc;
+}
+
+// Replaces buf/len with [u32 raw_len][lz block] in w->zbuf if that is
+// smaller; returns the flags to send with. Caller holds w->lock.
+static uint8_t maybe_compress(FrameWriter *w, uint8_t type, const void **buf, uint32_t *len) {
+    if (type != FT_STDOUT && type != FT_STDERR) return 0;
+    w->raw_bytes += *len;
+    uint8_t flags = 0;
+    size_t need = 4 + lz_bound(*len);
+    if (w->compress && g_compress_min > 0 && *len >= g_compress_min && *len > 16) {
+        if (w->zcap < need) {
+            char *nb = realloc(w->zbuf, need);
+            if (nb) { w->zbuf = nb; w->zcap = need; }
+        }
+        // Capping the output below the raw size makes incompressible data
+        // bail out early; it is then sent as is.
+        size_t z = w->zcap >= need ? lz_compress(*buf, *len, w->zbuf + 4, *len - 5) : 0;
+        if (z > 0) {
+            wire_put_u32(w->zbuf, *len);
+            *buf = w->zbuf;
+            *len = (uint32_t)(z + 4);
+            flags = FF_COMPRESSED;
+        }
+    }
+    w->wire_bytes += *len;
+    return flags;
+}
+
+static int send_locked(FrameWriter *w, uint32_t req_id, uint8_t type,
+                       const void *buf, uint32_t len) {
+    if (w->err) return -1;
+    if (w->fmt != FRAME_V2 && (type == FT_EXIT || type == FT_TIMING)) return 0;
+    if (type == FT_END) len = 0;
+    uint8_t flags = maybe_compress(w, type, &buf, &len);
+
+    char hdr[FRAME_MAX_HDR];
+    size_t hlen = frame_encode_hdr(w->fmt, req_id, type, flags, len, hdr);
+    size_t need = hlen + (size_t)len;
+    if (g_mode == FW_LATENCY || w->len + need > g_max_bytes) {
+        // Too big to batch (or batching is off): pending + this frame, one writev
+        return write_out(w, hdr, hlen, buf, len);
+    }
+
+    if (w->len + need > w->cap) {
+        size_t ncap = w->cap ? w->cap : 1024;
+        while (ncap < w->len + need) ncap *= 2;
+        char *nb = realloc(w->buf, ncap);
+        if (!nb) return write_out(w, hdr, hlen, buf, len);
+        w->buf = nb; w->cap = ncap;
+    }
+    if (w->len == 0) w->first_us = now_us();
+    memcpy(w->buf + w->len, hdr, hlen);
+    if (len) memcpy(w->buf + w->len + hlen, buf, len);
+    w->len += need;
+
+    if (now_us() - w->first_us >= g_max_delay_us) return flush_locked(w);
+    return 0;
+}
+
+int fw_send_typed(FrameWriter *w, uint32_t req_id, uint8_t type, const void *buf, uint32_t len) {
+    pthread_mutex_lock(&w->lock);
+    int rc = send_locked(w, req_id, type, buf, len);
+    pthread_mutex_unlock(&w->lock);
+    return rc;
+}
+
+int fw_send_tagged(FrameWriter *w, uint32_t req_id, const void *buf, uint32_t len) {
+    return fw_send_typed(w, req_id, len ? FT_STDOUT : FT_END, buf, len);
+}
+
+int fw_send(FrameWriter *w, const void *buf, uint32_t len) {
+    return fw_send_tagged(w, 0, buf, len);
+}
+
+void fw_wait_readable(FrameWriter *w, int fd) {
+    pthread_mutex_lock(&w->lock);
+    size_t pending = w->len;
+    uint64_t first = w->first_us;
+    pthread_mutex_unlock(&w->lock);
+    if (pending == 0) return;  // nothing pending: the caller's blocking read is fine
+
+    uint64_t age = now_us() - first;
+    int timeout_ms = age >= g_max_delay_us ? 0 : (int)((g_max_delay_us - age + 999) / 1000);
+    struct pollfd p = { .fd = fd, .events = POLLIN };
+    int rc;
+    while ((rc = poll(&p, 1, timeout_ms)) < 0 && errno == EINTR) {}
+    if (rc == 0) fw_flush(w);  // deadline hit before more output showed up
+}
+
+ssize_t fw_send_and_read(FrameWriter *w, uint32_t req_id, const void *buf, uint32_t len,
+                         int rfd, void *rbuf, size_t rcap) {
+    pthread_mutex_lock(&w->lock);
+    // Batched send+read only on V1 connections: one command at a time means
+    // nobody else writes meanwhile, and the read may block on the child, so
+    // it cannot run under the lock.
+    if (g_mode == FW_LATENCY && w->fmt == FRAME_V1 && w->len == 0 && !w->err) {
+        char hdr[FRAME_MAX_HDR];
+        size_t hlen = frame_encode_hdr(w->fmt, req_id, FT_STDOUT, 0, len, hdr);
+        int rc;
+        pthread_mutex_unlock(&w->lock);
+        ssize_t r = io_send_and_read(w->fd, hdr, hlen, buf, len, rfd, rbuf, rcap, &rc);
+        if (rc < 0) w->err = -1;
+        return r;
+    }
+    send_locked(w, req_id, FT_STDOUT, buf, len);
+    pthread_mutex_unlock(&w->lock);
+    fw_wait_readable(w, rfd);
+    return io_read(rfd, rbuf, rcap);
+}
+
+static void wait_fd(int fd, short events) {
+    struct pollfd p = { .fd = fd, .events = events };
+    while (poll(&p, 1, -1) < 0 && errno == EINTR) {}
+}
+
+ssize_t fw_splice_frame(FrameWriter *w, uint32_t req_id, uint8_t type, int pipe_fd, size_t max_len) {
+    wait_fd(pipe_fd, POLLIN);
+    int avail = 0;
+    if (ioctl(pipe_fd, FIONREAD, &avail) < 0) return -1;
+    if (avail <= 0) return 0;  // woke up on POLLHUP with nothing left: EOF
+
+    // Only we read this pipe, so at least `n` bytes stay available
+    size_t n = (size_t)avail < max_len ? (size_t)avail : max_len;
+    char hdr[FRAME_MAX_HDR];
+    size_t hlen = frame_encode_hdr(w->fmt, req_id, type, 0, (uint32_t)n, hdr);
+
+    // Header and payload must not interleave with another job's frame
+    pthread_mutex_lock(&w->lock);
+    if (flush_locked(w) < 0) { pthread_mutex_unlock(&w->lock); return -1; }  // earlier frames go first
+
+    // MSG_MORE lets the header share a segment with the spliced payload
+    size_t sent = 0;
+    while (sent < hlen) {
+        ssize_t r = send(w->fd, hdr + sent, hlen - sent, MSG_MORE | MSG_NOSIGNAL);
+        if (r > 0) { sent += r; continue; }
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { wait_fd(w->fd, POLLOUT); continue; }
+        w->err = -1;
+        pthread_mutex_unlock(&w->lock);
+        return -1;
+    }
+
+    size_t left = n;
+    while (left > 0) {
+        ssize_t r = splice(pipe_fd, NULL, w->fd, NULL, left, SPLICE_F_MOVE);
+        if (r > 0) { left -= r; continue; }
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { wait_fd(w->fd, POLLOUT); continue; }
+        w->err = -1;
+        pthread_mutex_unlock(&w->lock);
+        return -1;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return (ssize_t)n;
+}
+
+// ---------------------------------------------------------------------------
+// Frame reader
+// ---------------------------------------------------------------------------
+
+#define FR_INITIAL_CAP 4096
+
+void fr_init(FrameReader *r, int fd, size_t max_frame) {
+    memset(r, 0, sizeof(*r));
+    r->fd = fd;
+    r->fmt = FRAME_V1;
+    r->max_frame = max_frame ? max_frame : FR_DEFAULT_MAX_FRAME;
+    int domain = 0;
+    socklen_t dlen = sizeof(domain);
+    r->unix_sock = getsockopt(fd, SOL_SOCKET, SO_DOMAIN, &domain, &dlen) == 0 && domain == AF_UNIX;
+}
+
+void fr_destroy(FrameReader *r) {
+    free(r->buf);
+    r->buf = NULL;
+    r->start = r->end = r->cap = 0;
+    while (r->nfds > 0) close(r->fds[--r->nfds]);
+}
+
+int fr_take_fd(FrameReader *r) {
+    if (r->nfds == 0) return -1;
+    int fd = r->fds[0];
+    memmove(r->fds, r->fds + 1, sizeof(int) * --r->nfds);
+    return fd;
+}
+
+// read() for unix sockets: also queues any SCM_RIGHTS descriptors
+static ssize_t fr_recvmsg(FrameReader *r, void *buf, size_t len) {
+    char ctl[CMSG_SPACE(sizeof(int) * FR_MAX_FDS)];
+    struct iovec iov = { buf, len };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+                          .msg_control = ctl, .msg_controllen = sizeof(ctl) };
+    ssize_t n;
+    do { n = recvmsg(r->fd, &msg, MSG_CMSG_CLOEXEC); } while (n < 0 && errno == EINTR);
+    if (n < 0) return n;
+
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+        int cnt = (int)((c->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        int *fds = (int *)CMSG_DATA(c);
+        for (int i = 0; i < cnt; i++) {
+            if (r->nfds < FR_MAX_FDS) r->fds[r->nfds++] = fds[i];
+            else close(fds[i]);
+        }
+    }
+    return n;
+}
+
+// Undo the NUL written after the previous view
+static void fr_unpatch(FrameReader *r) {
+    if (r->patched) { *r->patched = r->saved; r->patched = NULL; }
+}
+
+// Bytes the frame currently at `start` needs in total (0 if unknown yet)
+static size_t fr_pending_frame_size(FrameReader *r) {
+    size_t hlen = frame_hdr_size(r->fmt);
+    if (r->end - r->start < hlen) return 0;
+    return hlen + (size_t)wire_get_u32(r->buf + r->start);
+}
+
+ssize_t fr_fill(FrameReader *r, bool block) {
+    fr_unpatch(r);
+
+    // Make room: slide unparsed bytes to the front, grow only if one frame
+    // (plus the NUL slot) really needs more than we have.
+    size_t want = fr_pending_frame_size(r) + 1;
+    if (want < FR_INITIAL_CAP) want = FR_INITIAL_CAP;
+    if (want > r->max_frame + FRAME_MAX_HDR + 1) want = r->max_frame + FRAME_MAX_HDR + 1;
+    if (r->start > 0 && (r->end + 1 >= r->cap || r->cap - r->start < want)) {
+        memmove(r->buf, r->buf + r->start, r->end - r->start);
+        r->end -= r->start;
+        r->start = 0;
+    }
+    if (r->cap < want) {
+        char *nb = realloc(r->buf, want);
+        if (!nb) return -1;
+        r->buf = nb;
+        r->cap = want;
+    }
+    if (r->end + 1 >= r->cap) { errno = EMSGSIZE; return -1; }
+
+    // Always leave the last byte free so a view's NUL never runs off the end
+    size_t room = r->cap - r->end - 1;
+    ssize_t n;
+    if (r->unix_sock) {
+        while ((n = fr_recvmsg(r, r->buf + r->end, room)) < 0 && block &&
+               (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            wait_fd(r->fd, POLLIN);
+        }
+    } else if (block) {
+        n = io_read(r->fd, r->buf + r->end, room);
+    } else {
+        do { n = read(r->fd, r->buf + r->end, room); } while (n < 0 && errno == EINTR);
+    }
+    if (n > 0) r->end += n;
+    return n;
+}
+
+int fr_next(FrameReader *r, FrameView *v) {
+    fr_unpatch(r);
+    size_t need = fr_pending_frame_size(r);
+    if (need == 0) return 0;
+    size_t hlen = frame_hdr_size(r->fmt);
+    if (need - hlen > r->max_frame) { errno = EMSGSIZE; return -1; }
+    if (r->end - r->start < need) return 0;
+
+    FrameHdr h;
+    frame_decode_hdr(r->fmt, r->buf + r->start, &h);
+    v->req_id = h.req_id;
+    v->type = h.type;
+    v->flags = h.flags;
+    v->data = r->buf + r->start + hlen;
+    v->len = (uint32_t)(need - hlen);
+    r->start += need;
+
+    // NUL-terminate in place; the byte after the payload is either the next
+    // header (restored on the next call) or free space (the +1 in fr_fill).
+    r->patched = v->data + v->len;
+    r->saved = *r->patched;
+    *r->patched = 0;
+
+    if (r->start == r->end) r->start = r->end = 0;  // cheap reset when drained
+    return 1;
+}
+
+int fr_read_frame(FrameReader *r, FrameView *v) {
+    for (;;) {
+        int rc = fr_next(r, v);
+        if (rc != 0) return rc;
+        ssize_t n = fr_fill(r, true);
+        if (n == 0) return r->end == r->start ? 0 : -1;  // EOF mid-frame is an error
+        if (n < 0) return -1;
+    }
+}
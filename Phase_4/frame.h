@@ -0,0 +1,125 @@
+#ifndef FRAME_H
+#define FRAME_H
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "wire.h"
+
+// ---------------------------------------------------------------------------
+// Frame writer: one per connection. Header and payload always leave in a
+// single writev, and in throughput mode small frames are coalesced until
+// either the size or the deadline threshold is hit, or fw_flush() is called.
+// With `compress` set (v2 + "lz"), output frames of at least the configured
+// size are sent compressed when that makes them smaller.
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    FW_LATENCY,     // every frame is written immediately
+    FW_THROUGHPUT   // small frames are batched (size / deadline bound)
+} FwMode;
+
+typedef struct FrameWriter {
+    int fd;
+    FrameFormat fmt;
+    pthread_mutex_t lock;   // several jobs of one connection may write
+    char *buf;              // pending frames, headers included
+    size_t len, cap;
+    uint64_t first_us;      // when the oldest pending byte was queued
+    int err;                // sticky: set once a write has failed
+    bool compress;
+    char *zbuf;             // compression scratch
+    size_t zcap;
+    uint64_t raw_bytes, wire_bytes;  // output payload before/after compression
+    int out_fds[2];         // local mode: the client's own stdout/stderr
+                            // (-1 = output travels as frames)
+} FrameWriter;
+
+// Server-wide writer policy (call once at startup)
+void fw_configure(FwMode mode, size_t max_bytes, unsigned max_delay_us);
+FwMode fw_mode(void);
+// Smallest payload worth compressing; 0 turns compression off
+void fw_set_compress_min(size_t bytes);
+size_t fw_compress_min(void);
+
+// Also turns on TCP_NODELAY: the writer does its own batching, so Nagle
+// would only add delayed-ACK stalls on top of it.
+void fw_init(FrameWriter *w, int fd);
+void fw_destroy(FrameWriter *w);
+
+// Queues (or sends) one frame. Returns -1 once the connection is broken.
+// fw_send_typed() maps `type` onto older formats as described above;
+// fw_send_tagged() sends output, or END when len is 0.
+int fw_send(FrameWriter *w, const void *buf, uint32_t len);
+int fw_send_tagged(FrameWriter *w, uint32_t req_id, const void *buf, uint32_t len);
+int fw_send_typed(FrameWriter *w, uint32_t req_id, uint8_t type, const void *buf, uint32_t len);
+
+// Writes out everything pending. Returns 0 or -1.
+int fw_flush(FrameWriter *w);
+
+// Waits for `fd` to become readable. If frames are pending and their
+// deadline expires first, they are flushed before waiting further.
+void fw_wait_readable(FrameWriter *w, int fd);
+
+// Sends a frame and reads the next chunk from `rfd` (see
+// io_send_frame_and_read); in throughput mode the frame is coalesced.
+ssize_t fw_send_and_read(FrameWriter *w, uint32_t req_id, const void *buf, uint32_t len,
+                         int rfd, void *rbuf, size_t rcap);
+
+// Zero-copy variant for child output: waits for data in `pipe_fd`, then
+// frames whatever is buffered there (up to max_len) and splice()s it
+// straight into the socket. Returns the payload size, 0 on EOF, -1 on error.
+ssize_t fw_splice_frame(FrameWriter *w, uint32_t req_id, uint8_t type, int pipe_fd, size_t max_len);
+
+// ---------------------------------------------------------------------------
+// Frame reader: one per connection. Each fill reads as much as the socket
+// has into a receive buffer; fr_next() then parses complete frames out of
+// it without further syscalls and hands out views into the buffer.
+//
+// The buffer is linear and compacted lazily (instead of wrapping) so every
+// payload is contiguous. A view is NUL-terminated in place and stays valid
+// until the next fr_fill()/fr_next() call on the same reader.
+// ---------------------------------------------------------------------------
+
+#define FR_DEFAULT_MAX_FRAME (1024 * 1024)
+#define FR_MAX_FDS 8
+
+typedef struct {
+    char *data;     // payload, NUL-terminated
+    uint32_t len;
+    uint32_t req_id;  // 0 on FRAME_V1
+    uint8_t type;     // FT_CMD unless FRAME_V2 says otherwise
+    uint8_t flags;
+} FrameView;
+
+typedef struct FrameReader {
+    int fd;
+    FrameFormat fmt;
+    char *buf;
+    size_t start, end, cap;  // unparsed bytes are buf[start, end)
+    size_t max_frame;        // larger length prefixes are a protocol error
+    char *patched;           // where the last view's NUL was written...
+    char saved;              // ...and the byte it replaced
+    bool unix_sock;          // AF_UNIX: fills use recvmsg to pick up SCM_RIGHTS
+    int fds[FR_MAX_FDS];     // descriptors received so far, oldest first
+    int nfds;
+} FrameReader;
+
+// Unix-domain sockets are detected here; descriptors the peer passes with
+// SCM_RIGHTS are queued and handed out by fr_take_fd() in arrival order.
+void fr_init(FrameReader *r, int fd, size_t max_frame);
+void fr_destroy(FrameReader *r);   // closes descriptors nobody took
+int fr_take_fd(FrameReader *r);    // -1 if none is queued
+
+// One read() into the buffer. `block` uses the io backend and waits for data;
+// otherwise EAGAIN is returned as -1/errno. Returns bytes read, 0 on EOF.
+ssize_t fr_fill(FrameReader *r, bool block);
+
+// 1 = *v holds the next frame, 0 = need more bytes, -1 = frame too large
+int fr_next(FrameReader *r, FrameView *v);
+
+// Blocking convenience: 1 = frame, 0 = clean EOF, -1 = error / bad frame
+int fr_read_frame(FrameReader *r, FrameView *v);
+
+#endif
@@ -0,0 +1,235 @@
+// io.c - net.c-style and io_uring implementations of the frame/pipe I/O
+#define _GNU_SOURCE
+#include "io.h"
+#include "uring.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RING_ENTRIES 8
+
+static IoBackend g_backend = IO_BACKEND_NET;
+
+// Each thread that does I/O gets its own small ring (threads mode has one
+// thread per client, reactor mode one executor), so no locking is needed.
+static __thread URing t_ring;
+static __thread int t_ring_state;   // 0 = not set up, 1 = ok, -1 = failed
+static __thread unsigned long t_syscalls;
+static pthread_key_t g_ring_key;
+static pthread_once_t g_ring_once = PTHREAD_ONCE_INIT;
+
+static void ring_release(void *arg) {
+    uring_destroy((URing *)arg);
+}
+
+static void ring_key_init(void) {
+    pthread_key_create(&g_ring_key, ring_release);
+}
+
+// Returns this thread's ring, or NULL to make the caller use the plain path
+static URing *thread_ring(void) {
+    if (g_backend != IO_BACKEND_URING || t_ring_state < 0) return NULL;
+    if (t_ring_state == 0) {
+        if (uring_setup(&t_ring, RING_ENTRIES) < 0) {
+            t_ring_state = -1;
+            return NULL;
+        }
+        pthread_once(&g_ring_once, ring_key_init);
+        pthread_setspecific(g_ring_key, &t_ring);  // torn down at thread exit
+        t_ring_state = 1;
+    }
+    return &t_ring;
+}
+
+static void wait_fd(int fd, short events) {
+    struct pollfd p = { .fd = fd, .events = events };
+    t_syscalls++;
+    while (poll(&p, 1, -1) < 0 && errno == EINTR) {}
+}
+
+IoBackend io_set_backend(IoBackend b) {
+    g_backend = IO_BACKEND_NET;
+    if (b == IO_BACKEND_URING) {
+        URing probe;
+        if (uring_setup(&probe, RING_ENTRIES) == 0) {
+            uring_destroy(&probe);
+            g_backend = IO_BACKEND_URING;
+        }
+    }
+    return g_backend;
+}
+
+IoBackend io_get_backend(void) { return g_backend; }
+
+const char *io_backend_name(IoBackend b) {
+    return b == IO_BACKEND_URING ? "uring" : "net";
+}
+
+unsigned long io_syscalls(void) { return t_syscalls; }
+
+// Skips `done` bytes in an iovec array; returns the new start index
+static int iov_advance(struct iovec *iov, int iovcnt, size_t done) {
+    int i = 0;
+    while (i < iovcnt && done >= iov[i].iov_len) { done -= iov[i].iov_len; i++; }
+    if (i < iovcnt) {
+        iov[i].iov_base = (char *)iov[i].iov_base + done;
+        iov[i].iov_len -= done;
+    }
+    return i;
+}
+
+// ---------------------------------------------------------------------------
+// io_uring helpers
+// ---------------------------------------------------------------------------
+
+static void prep_rw(struct io_uring_sqe *sqe, int op, int fd, const struct iovec *iov,
+                    int iovcnt, uint64_t tag) {
+    sqe->opcode = op;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)iov;
+    sqe->len = (unsigned)iovcnt;
+    sqe->off = (uint64_t)-1;  // pipes and sockets: current position
+    sqe->user_data = tag;
+}
+
+// Submits what is queued, waits for `n` completions and stores each result
+// in res[user_data]. Returns 0, or -1 if the ring itself failed.
+static int ring_run(URing *r, unsigned n, int *res) {
+    t_syscalls++;
+    if (uring_submit_and_wait(r, n) < 0) return -1;
+    unsigned got = 0;
+    while (got < n) {
+        uint64_t tag; int rc;
+        if (uring_reap(r, &tag, &rc)) { res[tag] = rc; got++; continue; }
+        t_syscalls++;
+        if (uring_submit_and_wait(r, n - got) < 0) return -1;
+    }
+    return 0;
+}
+
+static ssize_t uring_one(URing *r, int op, int fd, struct iovec *iov, int iovcnt) {
+    for (;;) {
+        int res[1];
+        prep_rw(uring_get_sqe(r), op, fd, iov, iovcnt, 0);
+        if (ring_run(r, 1, res) < 0) return -1;
+        if (res[0] >= 0) return res[0];
+        if (res[0] == -EINTR) continue;
+        if (res[0] == -EAGAIN) { wait_fd(fd, op == IORING_OP_READV ? POLLIN : POLLOUT); continue; }
+        errno = -res[0];
+        return -1;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+ssize_t io_read(int fd, void *buf, size_t n) {
+    URing *r = thread_ring();
+    if (r) {
+        struct iovec iov = { buf, n };
+        return uring_one(r, IORING_OP_READV, fd, &iov, 1);
+    }
+    for (;;) {
+        t_syscalls++;
+        ssize_t got = read(fd, buf, n);
+        if (got >= 0) return got;
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) { wait_fd(fd, POLLIN); continue; }
+        return -1;
+    }
+}
+
+ssize_t io_readn(int fd, void *buf, size_t n) {
+    size_t left = n; char *p = buf;
+    while (left > 0) {
+        ssize_t r = io_read(fd, p, left);
+        if (r == 0) return (ssize_t)(n - left); // EOF
+        if (r < 0) return -1;
+        left -= r; p += r;
+    }
+    return (ssize_t)n;
+}
+
+ssize_t io_writev_all(int fd, struct iovec *iov, int iovcnt) {
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) total += iov[i].iov_len;
+
+    URing *r = thread_ring();
+    size_t left = total;
+    while (left > 0) {
+        ssize_t w;
+        if (r) {
+            w = uring_one(r, IORING_OP_WRITEV, fd, iov, iovcnt);
+        } else {
+            t_syscalls++;
+            w = writev(fd, iov, iovcnt);
+            if (w < 0 && errno == EINTR) continue;
+            if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { wait_fd(fd, POLLOUT); continue; }
+        }
+        if (w <= 0) return -1;
+        left -= (size_t)w;
+        int skip = iov_advance(iov, iovcnt, (size_t)w);
+        iov += skip; iovcnt -= skip;
+    }
+    return (ssize_t)total;
+}
+
+int io_send_frame(int fd, const void *buf, uint32_t len) {
+    uint32_t be = htonl(len);
+    struct iovec iov[2] = { { &be, 4 }, { (void *)buf, len } };
+
+    // Header and payload in one writev: two separate writes would hit the
+    // Nagle / delayed-ACK write-write-read stall.
+    return io_writev_all(fd, iov, len ? 2 : 1) < 0 ? -1 : 0;
+}
+
+ssize_t io_send_and_read(int sfd, const void *hdr, size_t hlen, const void *buf, uint32_t len,
+                         int rfd, void *rbuf, size_t rcap, int *send_rc) {
+    struct iovec wiov[2] = { { (void *)hdr, hlen }, { (void *)buf, len } };
+    int wcnt = len ? 2 : 1;
+
+    URing *r = thread_ring();
+    if (!r) {
+        *send_rc = io_writev_all(sfd, wiov, wcnt) < 0 ? -1 : 0;
+        return io_read(rfd, rbuf, rcap);
+    }
+
+    struct iovec riov = { rbuf, rcap };
+    int res[2];
+
+    // Frame send and the next pipe read go out in one io_uring_enter()
+    prep_rw(uring_get_sqe(r), IORING_OP_WRITEV, sfd, wiov, wcnt, 0);
+    prep_rw(uring_get_sqe(r), IORING_OP_READV, rfd, &riov, 1, 1);
+    if (ring_run(r, 2, res) < 0) {
+        *send_rc = -1;
+        return -1;
+    }
+
+    // Finish a short/EAGAIN send on the slow path
+    size_t want = hlen + (size_t)len;
+    size_t sent = res[0] > 0 ? (size_t)res[0] : 0;
+    *send_rc = 0;
+    if (res[0] < 0 && res[0] != -EAGAIN && res[0] != -EINTR) {
+        *send_rc = -1;
+    } else if (sent < want) {
+        int skip = iov_advance(wiov, wcnt, sent);
+        if (io_writev_all(sfd, wiov + skip, wcnt - skip) < 0) *send_rc = -1;
+    }
+
+    if (res[1] >= 0) return res[1];
+    if (res[1] == -EAGAIN || res[1] == -EINTR) return io_read(rfd, rbuf, rcap);
+    errno = -res[1];
+    return -1;
+}
+
+ssize_t io_send_frame_and_read(int sfd, const void *buf, uint32_t len,
+                               int rfd, void *rbuf, size_t rcap, int *send_rc) {
+    uint32_t be = htonl(len);
+    return io_send_and_read(sfd, &be, 4, buf, len, rfd, rbuf, rcap, send_rc);
+}
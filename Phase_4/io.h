@@ -0,0 +1,54 @@
+#ifndef IO_H
+#define IO_H
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// Pluggable I/O backend for the frame/pipe hot paths.
+//   IO_BACKEND_NET   - plain read/write/writev (the net.c path)
+//   IO_BACKEND_URING - submissions through a per-thread io_uring. The
+//                      shell-output path batches each frame send with the
+//                      next pipe read (io_send_and_read). Socket receives
+//                      are deliberately one submission each: a connection
+//                      thread reads a command only after the reply frames
+//                      have gone out, often from a job thread, so it has
+//                      no send or pipe read of its own to batch them with.
+typedef enum {
+    IO_BACKEND_NET,
+    IO_BACKEND_URING
+} IoBackend;
+
+// Selects the backend at startup. Falls back to IO_BACKEND_NET if io_uring
+// is not usable on this kernel; returns the backend actually in effect.
+IoBackend io_set_backend(IoBackend b);
+IoBackend io_get_backend(void);
+const char *io_backend_name(IoBackend b);
+
+// read() once (may return fewer than n bytes, 0 on EOF); a single SQE with
+// io_uring, see above
+ssize_t io_read(int fd, void *buf, size_t n);
+
+// Reads exactly n bytes unless EOF/error first (same contract as readn)
+ssize_t io_readn(int fd, void *buf, size_t n);
+
+// Writes all iovecs completely; returns total bytes or -1
+ssize_t io_writev_all(int fd, struct iovec *iov, int iovcnt);
+
+// Sends one length-prefixed frame (header + payload in one submission)
+int io_send_frame(int fd, const void *buf, uint32_t len);
+
+// Sends a frame (already-encoded header `hdr` + payload) on `sfd` and reads
+// the next chunk from `rfd` into `rbuf`. With io_uring both go out in a
+// single io_uring_enter(). Returns the read result; *send_rc is set to 0 or
+// -1 for the send.
+ssize_t io_send_and_read(int sfd, const void *hdr, size_t hlen, const void *buf, uint32_t len,
+                         int rfd, void *rbuf, size_t rcap, int *send_rc);
+
+// Same, for a plain 4-byte-length frame
+ssize_t io_send_frame_and_read(int sfd, const void *buf, uint32_t len,
+                               int rfd, void *rbuf, size_t rcap, int *send_rc);
+
+// Number of I/O syscalls issued by the calling thread so far
+unsigned long io_syscalls(void);
+
+#endif
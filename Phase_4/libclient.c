@@ -0,0 +1,496 @@
+// libclient.c - non-blocking client library (see libclient.h)
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "libclient.h"
+#include "lz.h"
+#include "wire.h"
+
+#define RBUF_INIT (64 * 1024)
+#define MAX_EVENTS 64
+
+typedef struct Cmd {
+    char *text;                 // command line, newline included
+    size_t len;
+    lc_output_cb out;
+    lc_done_cb done;
+    void *arg;
+    uint32_t req_id;
+    LcResult res;
+    struct Cmd *next;           // client queue
+} Cmd;
+
+typedef enum {
+    CS_DOWN,
+    CS_CONNECTING,              // non-blocking connect() in progress
+    CS_HELLO,                   // waiting for the protocol handshake reply
+    CS_READY
+} ConnState;
+
+typedef struct Conn {
+    struct LcClient *c;
+    int fd;
+    ConnState state;
+    uint32_t events;            // what epoll is watching for
+    char *rbuf;                 // unparsed input is rbuf[rstart, rend)
+    size_t rcap, rstart, rend;
+    char *wbuf;                 // unsent output is wbuf[woff, wlen)
+    size_t wcap, wlen, woff;
+    Cmd **slots;                // in-flight commands, slot = req_id % window
+    int inflight;
+    uint32_t seq;
+    uint64_t dial_us;           // when the current connect() started
+} Conn;
+
+struct LcClient {
+    int epfd;
+    Conn *conns;
+    int nconns, window;
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    bool compress;
+    lc_connect_cb on_connect;
+    void *connect_arg;
+    Cmd *qhead, *qtail;         // submitted, waiting for a free slot
+    int pending;
+    int completed;              // by the current lc_process() call
+    char *zbuf;                 // decompressed payload of the last frame
+    size_t zcap;
+};
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static void report_connect(Conn *k, bool ok) {
+    if (k->c->on_connect) k->c->on_connect(k->c->connect_arg, ok, now_us() - k->dial_us);
+}
+
+static void conn_arm(Conn *k) {
+    uint32_t ev = EPOLLIN;
+    if (k->state == CS_CONNECTING || k->woff < k->wlen) ev |= EPOLLOUT;
+    if (ev == k->events) return;
+    struct epoll_event e = { .events = ev, .data.ptr = k };
+    epoll_ctl(k->c->epfd, EPOLL_CTL_MOD, k->fd, &e);
+    k->events = ev;
+}
+
+static int wbuf_append(Conn *k, const void *data, size_t len) {
+    if (k->wlen + len > k->wcap) {
+        size_t cap = k->wcap ? k->wcap : 4096;
+        while (cap < k->wlen + len) cap *= 2;
+        char *nb = realloc(k->wbuf, cap);
+        if (!nb) return -1;
+        k->wbuf = nb;
+        k->wcap = cap;
+    }
+    memcpy(k->wbuf + k->wlen, data, len);
+    k->wlen += len;
+    return 0;
+}
+
+static void finish(LcClient *c, Cmd *cmd) {
+    c->pending--;
+    c->completed++;
+    if (cmd->done) cmd->done(cmd->arg, &cmd->res);
+    free(cmd->text);
+    free(cmd);
+}
+
+static void fail_queue(LcClient *c) {
+    while (c->qhead) {
+        Cmd *cmd = c->qhead;
+        c->qhead = cmd->next;
+        cmd->res.status = LC_ERR_CONN;
+        finish(c, cmd);
+    }
+    c->qtail = NULL;
+}
+
+static int conn_start(Conn *k) {
+    LcClient *c = k->c;
+    k->dial_us = now_us();
+    k->fd = socket(c->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (k->fd < 0) return -1;
+    if (c->addr.ss_family != AF_UNIX) {
+        int one = 1;
+        setsockopt(k->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    if (connect(k->fd, (struct sockaddr *)&c->addr, c->addrlen) < 0 && errno != EINPROGRESS) {
+        close(k->fd);
+        k->fd = -1;
+        report_connect(k, false);
+        return -1;
+    }
+    k->state = CS_CONNECTING;
+    k->events = EPOLLIN | EPOLLOUT;
+    struct epoll_event e = { .events = k->events, .data.ptr = k };
+    if (epoll_ctl(c->epfd, EPOLL_CTL_ADD, k->fd, &e) < 0) {
+        close(k->fd);
+        k->fd = -1;
+        k->state = CS_DOWN;
+        return -1;
+    }
+    return 0;
+}
+
+static bool any_conn_up(LcClient *c) {
+    for (int i = 0; i < c->nconns; i++) {
+        if (c->conns[i].state != CS_DOWN) return true;
+    }
+    return false;
+}
+
+// Drops the connection and fails its commands. A connection that was
+// working is redialled; if none can even be set up, queued commands fail
+// too instead of waiting forever.
+static void conn_fail(Conn *k) {
+    LcClient *c = k->c;
+    bool was_ready = k->state == CS_READY;
+    if (!was_ready) report_connect(k, false);
+    close(k->fd);
+    k->fd = -1;
+    k->state = CS_DOWN;
+    k->rstart = k->rend = 0;
+    k->wlen = k->woff = 0;
+    for (int i = 0; i < c->window; i++) {
+        Cmd *cmd = k->slots[i];
+        if (!cmd) continue;
+        k->slots[i] = NULL;
+        cmd->res.status = LC_ERR_CONN;
+        finish(c, cmd);
+    }
+    k->inflight = 0;
+    if (was_ready) conn_start(k);
+    if (!any_conn_up(c)) fail_queue(c);
+}
+
+// Hands queued commands to the least loaded ready connections
+static void dispatch(LcClient *c) {
+    while (c->qhead) {
+        Conn *best = NULL;
+        for (int i = 0; i < c->nconns; i++) {
+            Conn *k = &c->conns[i];
+            if (k->state != CS_READY || k->inflight >= c->window) continue;
+            if (!best || k->inflight < best->inflight) best = k;
+        }
+        if (!best) return;
+
+        int slot = 0;
+        while (best->slots[slot]) slot++;
+        Cmd *cmd = c->qhead;
+        c->qhead = cmd->next;
+        if (!c->qhead) c->qtail = NULL;
+
+        cmd->req_id = ++best->seq * (uint32_t)c->window + (uint32_t)slot;
+        char hdr[FRAME_V2_HDR];
+        frame_encode_hdr(FRAME_V2, cmd->req_id, FT_CMD, 0, (uint32_t)cmd->len, hdr);
+        if (wbuf_append(best, hdr, FRAME_V2_HDR) < 0 || wbuf_append(best, cmd->text, cmd->len) < 0) {
+            cmd->res.status = LC_ERR_CONN;
+            finish(c, cmd);
+            continue;
+        }
+        best->slots[slot] = cmd;
+        best->inflight++;
+        conn_arm(best);
+    }
+}
+
+static int conn_flush(Conn *k) {
+    while (k->woff < k->wlen) {
+        ssize_t n = write(k->fd, k->wbuf + k->woff, k->wlen - k->woff);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return -1;
+        }
+        k->woff += (size_t)n;
+    }
+    if (k->woff == k->wlen) k->woff = k->wlen = 0;
+    conn_arm(k);
+    return 0;
+}
+
+static void on_connected(Conn *k) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(k->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+        conn_fail(k);
+        return;
+    }
+    // The handshake itself still uses the v1 framing
+    const char *hello = k->c->compress ? "\0HELLO 2 lz" : "\0HELLO 2";
+    uint32_t hlen = 1 + (uint32_t)strlen(hello + 1);
+    char hdr[FRAME_MAX_HDR];
+    size_t n = frame_encode_hdr(FRAME_V1, 0, FT_CMD, 0, hlen, hdr);
+    k->state = CS_HELLO;
+    if (wbuf_append(k, hdr, n) < 0 || wbuf_append(k, hello, hlen) < 0 || conn_flush(k) < 0) {
+        conn_fail(k);
+    }
+}
+
+// Applies one v2 frame to the command it belongs to
+static int on_frame(Conn *k, uint32_t req_id, int type, int flags, const char *data, uint32_t len) {
+    LcClient *c = k->c;
+    int slot = (int)(req_id % (uint32_t)c->window);
+    Cmd *cmd = k->slots[slot];
+    if (!cmd || cmd->req_id != req_id) return 0;  // not ours (control replies)
+
+    if (flags & FF_COMPRESSED) {
+        // [u32 raw_len][lz block]
+        if (len < 4) return -1;
+        uint32_t raw = wire_get_u32(data);
+        if (raw > FRAME_MAX_RAW) return -1;
+        if (raw > c->zcap) {
+            char *nz = realloc(c->zbuf, raw);
+            if (!nz) return -1;
+            c->zbuf = nz;
+            c->zcap = raw;
+        }
+        if (lz_decompress(data + 4, len - 4, c->zbuf, raw) != (long)raw) return -1;
+        data = c->zbuf;
+        len = raw;
+    }
+
+    switch (type) {
+    case FT_STDOUT:
+    case FT_STDERR:
+        if (cmd->out && len) cmd->out(cmd->arg, type == FT_STDOUT ? LC_STDOUT : LC_STDERR, data, len);
+        break;
+    case FT_EXIT:
+        if (len >= 4) cmd->res.exit_code = (int)wire_get_u32(data);
+        break;
+    case FT_TIMING:
+        if (len >= FRAME_TIMING_SIZE) {
+            FrameTiming t;
+            frame_decode_timing(data, &t);
+            cmd->res.queue_us = t.queue_wait_us;
+            cmd->res.run_us = t.run_us;
+            cmd->res.total_us = t.turnaround_us;
+            cmd->res.has_timing = true;
+        }
+        break;
+    case FT_BUSY:
+        cmd->res.status = LC_BUSY;
+        if (len >= 4) cmd->res.retry_ms = wire_get_u32(data);
+        break;
+    case FT_END:
+        k->slots[slot] = NULL;
+        k->inflight--;
+        finish(c, cmd);
+        dispatch(c);  // the freed slot takes the next queued command
+        break;
+    }
+    return 0;
+}
+
+// Parses every complete frame in the read buffer
+static int parse_frames(Conn *k) {
+    for (;;) {
+        size_t have = k->rend - k->rstart;
+        const char *p = k->rbuf + k->rstart;
+        if (k->state == CS_HELLO) {
+            if (have < 4) return 0;
+            uint32_t len = wire_get_u32(p);
+            if (len == 0xFFFFFFFF) return -1;   // turned away
+            if (have < 4 + (size_t)len) return 0;
+            // "\0HELLO <ver> ..."; anything else (busy line, old server) is fatal
+            if (len < 8 || memcmp(p + 4, "\0HELLO ", 7) != 0) return -1;
+            int version = 0;
+            for (uint32_t i = 7; i < len && p[4 + i] >= '0' && p[4 + i] <= '9'; i++) {
+                version = version * 10 + (p[4 + i] - '0');
+            }
+            if (version < 2) return -1;
+            k->rstart += 4 + len;
+            k->state = CS_READY;
+            report_connect(k, true);
+            dispatch(k->c);
+            continue;
+        }
+        if (have < FRAME_V2_HDR) return 0;
+        FrameHdr h;
+        frame_decode_hdr(FRAME_V2, p, &h);
+        if (have < FRAME_V2_HDR + (size_t)h.len) return 0;
+        k->rstart += FRAME_V2_HDR + h.len;
+        if (on_frame(k, h.req_id, h.type, h.flags, p + FRAME_V2_HDR, h.len) < 0) {
+            return -1;
+        }
+    }
+}
+
+static void on_readable(Conn *k) {
+    for (;;) {
+        if (k->rstart == k->rend) k->rstart = k->rend = 0;
+        if (k->rend == k->rcap) {
+            if (k->rstart > 0) {
+                memmove(k->rbuf, k->rbuf + k->rstart, k->rend - k->rstart);
+                k->rend -= k->rstart;
+                k->rstart = 0;
+            } else {
+                size_t cap = k->rcap ? k->rcap * 2 : RBUF_INIT;
+                char *nb = realloc(k->rbuf, cap);
+                if (!nb) { conn_fail(k); return; }
+                k->rbuf = nb;
+                k->rcap = cap;
+            }
+        }
+        ssize_t n = read(k->fd, k->rbuf + k->rend, k->rcap - k->rend);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n <= 0) { conn_fail(k); return; }
+        k->rend += (size_t)n;
+        if (parse_frames(k) < 0) { conn_fail(k); return; }
+    }
+}
+
+static int resolve(LcClient *c, const LcConfig *cfg) {
+    if (cfg->unix_path) {
+        struct sockaddr_un *sun = (struct sockaddr_un *)&c->addr;
+        if (strlen(cfg->unix_path) >= sizeof(sun->sun_path)) return -1;
+        sun->sun_family = AF_UNIX;
+        strcpy(sun->sun_path, cfg->unix_path);
+        c->addrlen = sizeof(*sun);
+        return 0;
+    }
+    char port[8];
+    snprintf(port, sizeof(port), "%u", cfg->port ? cfg->port : 5050);
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM }, *res;
+    if (getaddrinfo(cfg->host ? cfg->host : "127.0.0.1", port, &hints, &res) != 0) return -1;
+    memcpy(&c->addr, res->ai_addr, res->ai_addrlen);
+    c->addrlen = res->ai_addrlen;
+    freeaddrinfo(res);
+    return 0;
+}
+
+LcClient *lc_create(const LcConfig *cfg) {
+    LcClient *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->nconns = cfg->connections > 0 ? cfg->connections : 4;
+    c->window = cfg->window > 0 ? cfg->window : 16;
+    c->compress = cfg->compress && !cfg->unix_path;  // nothing to gain locally
+    c->on_connect = cfg->on_connect;
+    c->connect_arg = cfg->connect_arg;
+    c->epfd = epoll_create1(EPOLL_CLOEXEC);
+    c->conns = calloc(c->nconns, sizeof(Conn));
+    if (c->epfd < 0 || !c->conns || resolve(c, cfg) < 0) {
+        if (c->epfd >= 0) close(c->epfd);
+        free(c->conns);
+        free(c);
+        return NULL;
+    }
+    for (int i = 0; i < c->nconns; i++) {
+        Conn *k = &c->conns[i];
+        k->c = c;
+        k->fd = -1;
+        k->slots = calloc(c->window, sizeof(Cmd *));
+        if (!k->slots) { lc_destroy(c); return NULL; }
+        conn_start(k);
+    }
+    return c;
+}
+
+// Commands still queued or in flight are dropped without callbacks
+void lc_destroy(LcClient *c) {
+    if (!c) return;
+    for (int i = 0; i < c->nconns; i++) {
+        Conn *k = &c->conns[i];
+        if (k->fd >= 0) close(k->fd);
+        for (int s = 0; k->slots && s < c->window; s++) {
+            if (k->slots[s]) { free(k->slots[s]->text); free(k->slots[s]); }
+        }
+        free(k->slots);
+        free(k->rbuf);
+        free(k->wbuf);
+    }
+    while (c->qhead) {
+        Cmd *cmd = c->qhead;
+        c->qhead = cmd->next;
+        free(cmd->text);
+        free(cmd);
+    }
+    close(c->epfd);
+    free(c->conns);
+    free(c->zbuf);
+    free(c);
+}
+
+int lc_submit(LcClient *c, const char *cmd, lc_output_cb out, lc_done_cb done, void *arg) {
+    size_t len = strlen(cmd);
+    bool nl = len > 0 && cmd[len - 1] == '\n';
+    Cmd *q = calloc(1, sizeof(*q));
+    char *text = malloc(len + 2);
+    if (!q || !text) { free(q); free(text); return -1; }
+    memcpy(text, cmd, len);
+    if (!nl) text[len++] = '\n';  // the server strips it, like the line the shell client reads
+    text[len] = '\0';
+    q->text = text;
+    q->len = len;
+    q->out = out;
+    q->done = done;
+    q->arg = arg;
+    q->res.status = LC_OK;
+
+    if (c->qtail) c->qtail->next = q;
+    else c->qhead = q;
+    c->qtail = q;
+    c->pending++;
+
+    // Redial connections that went down; a dead server fails the command
+    // from the next lc_process() instead of here
+    for (int i = 0; i < c->nconns; i++) {
+        if (c->conns[i].state == CS_DOWN) conn_start(&c->conns[i]);
+    }
+    if (!any_conn_up(c)) {
+        fail_queue(c);
+        return 0;
+    }
+    dispatch(c);  // only fills write buffers; lc_process() sends them
+    return 0;
+}
+
+int lc_fd(LcClient *c) {
+    return c->epfd;
+}
+
+int lc_pending(LcClient *c) {
+    return c->pending;
+}
+
+int lc_process(LcClient *c, int timeout_ms) {
+    struct epoll_event evs[MAX_EVENTS];
+    c->completed = 0;
+    int n = epoll_wait(c->epfd, evs, MAX_EVENTS, timeout_ms);
+    if (n < 0) return errno == EINTR ? 0 : -1;
+
+    for (int i = 0; i < n; i++) {
+        Conn *k = evs[i].data.ptr;
+        uint32_t ev = evs[i].events;
+        if (k->state == CS_CONNECTING) {
+            on_connected(k);
+            continue;
+        }
+        if (k->state == CS_DOWN) continue;
+        if (ev & (EPOLLIN | EPOLLHUP | EPOLLERR)) on_readable(k);
+        if (k->state >= CS_HELLO && (ev & EPOLLOUT) && conn_flush(k) < 0) conn_fail(k);
+    }
+
+    // Send what callbacks and lc_submit() queued right away, so the caller's
+    // next wait is for replies
+    for (int i = 0; i < c->nconns; i++) {
+        Conn *k = &c->conns[i];
+        if (k->state >= CS_HELLO && k->woff < k->wlen && conn_flush(k) < 0) conn_fail(k);
+    }
+    return c->completed;
+}
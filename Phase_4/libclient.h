@@ -0,0 +1,77 @@
+#ifndef LIBCLIENT_H
+#define LIBCLIENT_H
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// ---------------------------------------------------------------------------
+// libclient: non-blocking client for the scheduling server (protocol v2).
+//
+// A LcClient owns a pool of connections and spreads submitted commands over
+// them, several in flight per connection. Nothing blocks: lc_submit() only
+// queues, and all I/O happens in lc_process(). To drive it from your own
+// event loop, watch lc_fd() for EPOLLIN and call lc_process(c, 0) whenever
+// it is readable. Callbacks run from inside lc_process() and may submit
+// more commands, but must not call lc_destroy().
+// ---------------------------------------------------------------------------
+
+typedef struct LcClient LcClient;
+
+typedef enum {
+    LC_OK,          // command ran; see exit_code
+    LC_BUSY,        // server was overloaded and did not queue it; see retry_ms
+    LC_ERR_CONN     // connection failed or was lost before the command ended
+} LcStatus;
+
+typedef struct {
+    LcStatus status;
+    int exit_code;
+    unsigned retry_ms;
+    bool has_timing;            // server timing trailer (microseconds)
+    uint64_t queue_us, run_us, total_us;
+} LcResult;
+
+enum { LC_STDOUT = 1, LC_STDERR = 2 };
+
+// Output chunk of a command (`stream` is LC_STDOUT or LC_STDERR)
+typedef void (*lc_output_cb)(void *arg, int stream, const char *data, size_t len);
+// Called exactly once per submitted command (unless the client is
+// destroyed first)
+typedef void (*lc_done_cb)(void *arg, const LcResult *res);
+
+// A pooled connection finished its handshake (ok) or failed to get there;
+// connect_us is the time from dialling to the server's reply.
+typedef void (*lc_connect_cb)(void *arg, bool ok, uint64_t connect_us);
+
+// Zero fields mean the default
+typedef struct {
+    const char *host;           // "127.0.0.1"
+    uint16_t port;              // 5050
+    const char *unix_path;      // connect to this AF_UNIX socket instead
+    int connections;            // pool size (4)
+    int window;                 // commands in flight per connection (16)
+    bool compress;              // ask for compressed output (TCP only)
+    lc_connect_cb on_connect;   // optional, with connect_arg
+    void *connect_arg;
+} LcConfig;
+
+// Starts connecting the pool. NULL if the address is unusable.
+LcClient *lc_create(const LcConfig *cfg);
+void lc_destroy(LcClient *c);
+
+// Queues `cmd` (copied). `out` may be NULL to drop output. If no
+// connection can even be opened, `done` runs before this returns.
+int lc_submit(LcClient *c, const char *cmd, lc_output_cb out, lc_done_cb done, void *arg);
+
+// Readable when lc_process() has work to do
+int lc_fd(LcClient *c);
+
+// Handles whatever is ready, waiting up to timeout_ms (-1 = forever) for
+// something to happen. Returns the number of commands completed, or -1 on
+// an internal error.
+int lc_process(LcClient *c, int timeout_ms);
+
+// Commands submitted and not completed yet
+int lc_pending(LcClient *c);
+
+#endif
@@ -0,0 +1,251 @@
+// loadgen.c - load generator for the server, built on libclient
+//
+// Opens N connections and drives a weighted mix of commands, either
+// closed-loop (a fixed number of commands outstanding, the next one sent
+// as soon as one completes) or open-loop (commands arrive at a fixed rate
+// whether or not earlier ones have finished). Reports throughput and
+// p50/p99/p99.9 of:
+//   connect     dial to handshake reply, per connection
+//   queue wait  time the server kept the command queued (timing trailer)
+//   completion  arrival to END frame as the client saw it; in open loop
+//               measured from the scheduled arrival, so backlog counts
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <getopt.h>
+#include <math.h>
+#include <time.h>
+#include "libclient.h"
+
+#define MAX_MIX 32
+
+typedef struct {
+    char *cmd;
+    int weight;
+    unsigned long done;
+} MixEntry;
+
+typedef struct {
+    double *v;
+    size_t n, cap;
+} Samples;
+
+typedef struct {
+    double start_us;            // arrival (scheduled arrival in open loop)
+    int mix;
+} Req;
+
+static MixEntry g_mix[MAX_MIX];
+static int g_nmix, g_total_weight;
+static Samples g_connect, g_queue, g_complete;
+static unsigned long g_ok, g_busy, g_err, g_nonzero, g_submitted, g_completed;
+static unsigned long g_limit;       // commands to send (0 = until the deadline)
+static LcClient *g_client;
+static bool g_closed_loop;
+static bool g_stop;                 // no new commands (deadline or limit)
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void sample_add(Samples *s, double v) {
+    if (s->n == s->cap) {
+        s->cap = s->cap ? s->cap * 2 : 1024;
+        s->v = realloc(s->v, s->cap * sizeof(double));
+        if (!s->v) { perror("realloc"); exit(1); }
+    }
+    s->v[s->n++] = v;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report(const char *name, Samples *s) {
+    if (s->n == 0) { printf("  %-11s (no samples)\n", name); return; }
+    qsort(s->v, s->n, sizeof(double), cmp_double);
+    double sum = 0;
+    for (size_t i = 0; i < s->n; i++) sum += s->v[i];
+    printf("  %-11s n %-8zu mean %9.2f ms  p50 %9.2f ms  p99 %9.2f ms  p99.9 %9.2f ms  max %9.2f ms\n",
+           name, s->n, sum / s->n / 1e3, s->v[s->n / 2] / 1e3, s->v[(size_t)(s->n * 0.99)] / 1e3,
+           s->v[(size_t)(s->n * 0.999)] / 1e3, s->v[s->n - 1] / 1e3);
+}
+
+// "cmd@weight;cmd@weight;..." (weight defaults to 1)
+static int parse_mix(const char *spec) {
+    char *copy = strdup(spec), *save = NULL;
+    if (!copy) return -1;
+    g_nmix = g_total_weight = 0;
+    for (char *tok = strtok_r(copy, ";", &save); tok; tok = strtok_r(NULL, ";", &save)) {
+        if (g_nmix == MAX_MIX) break;
+        int w = 1;
+        char *at = strrchr(tok, '@');
+        if (at) { *at = '\0'; w = atoi(at + 1); }
+        if (w <= 0 || *tok == '\0') continue;
+        g_mix[g_nmix].cmd = strdup(tok);
+        g_mix[g_nmix].weight = w;
+        g_total_weight += w;
+        g_nmix++;
+    }
+    free(copy);
+    return g_nmix > 0 ? 0 : -1;
+}
+
+static int pick_mix(void) {
+    int r = rand() % g_total_weight;
+    for (int i = 0; i < g_nmix; i++) {
+        if (r < g_mix[i].weight) return i;
+        r -= g_mix[i].weight;
+    }
+    return g_nmix - 1;
+}
+
+static void submit(double start_us);
+
+static void on_done(void *arg, const LcResult *res) {
+    Req *r = arg;
+    double end = now_us();
+    g_completed++;
+    switch (res->status) {
+    case LC_OK:
+        g_ok++;
+        g_mix[r->mix].done++;
+        if (res->exit_code != 0) g_nonzero++;
+        sample_add(&g_complete, end - r->start_us);
+        if (res->has_timing) sample_add(&g_queue, (double)res->queue_us);
+        break;
+    case LC_BUSY:   g_busy++; break;
+    case LC_ERR_CONN: g_err++; break;
+    }
+    free(r);
+    if (g_closed_loop && !g_stop) submit(end);
+}
+
+static void on_connect(void *arg, bool ok, uint64_t connect_us) {
+    (void)arg;
+    if (ok) sample_add(&g_connect, (double)connect_us);
+}
+
+static void submit(double start_us) {
+    if (g_limit && g_submitted >= g_limit) { g_stop = true; return; }
+    Req *r = malloc(sizeof(*r));
+    if (!r) return;
+    r->start_us = start_us;
+    r->mix = pick_mix();
+    g_submitted++;
+    lc_submit(g_client, g_mix[r->mix].cmd, NULL, on_done, r);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -H, --host=HOST         server host (127.0.0.1)\n"
+        "  -p, --port=PORT         server port (5050)\n"
+        "  -s, --unix=PATH         connect over a unix socket instead\n"
+        "  -c, --connections=N     connections to open (8)\n"
+        "  -w, --window=N          commands in flight per connection (4)\n"
+        "  -r, --rate=CMDS_PER_S   open loop at this arrival rate (default: closed loop)\n"
+        "      --poisson           open loop with exponential inter-arrival times\n"
+        "  -n, --requests=N        stop after N commands\n"
+        "  -d, --duration=SEC      stop sending after SEC seconds (10, unless -n)\n"
+        "  -m, --mix=SPEC          weighted commands, 'cmd@weight;cmd@weight'\n"
+        "                          (default 'echo hi@6;ls@3;./demo 1@1')\n",
+        prog);
+}
+
+int main(int argc, char **argv) {
+    static const struct option opts[] = {
+        {"host",        required_argument, NULL, 'H'},
+        {"port",        required_argument, NULL, 'p'},
+        {"unix",        required_argument, NULL, 's'},
+        {"connections", required_argument, NULL, 'c'},
+        {"window",      required_argument, NULL, 'w'},
+        {"rate",        required_argument, NULL, 'r'},
+        {"poisson",     no_argument,       NULL, 1000},
+        {"requests",    required_argument, NULL, 'n'},
+        {"duration",    required_argument, NULL, 'd'},
+        {"mix",         required_argument, NULL, 'm'},
+        {"help",        no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    LcConfig cfg = { .connections = 8, .window = 4, .on_connect = on_connect };
+    const char *mix = "echo hi@6;ls@3;./demo 1@1";
+    double rate = 0, duration = 0;
+    bool poisson = false;
+    int c;
+    while ((c = getopt_long(argc, argv, "H:p:s:c:w:r:n:d:m:h", opts, NULL)) != -1) {
+        switch (c) {
+        case 'H': cfg.host = optarg; break;
+        case 'p': cfg.port = (uint16_t)atoi(optarg); break;
+        case 's': cfg.unix_path = optarg; break;
+        case 'c': cfg.connections = atoi(optarg); break;
+        case 'w': cfg.window = atoi(optarg); break;
+        case 'r': rate = atof(optarg); break;
+        case 1000: poisson = true; break;
+        case 'n': g_limit = strtoul(optarg, NULL, 10); break;
+        case 'd': duration = atof(optarg); break;
+        case 'm': mix = optarg; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (parse_mix(mix) < 0) { fprintf(stderr, "bad --mix\n"); return 1; }
+    if (cfg.connections < 1) cfg.connections = 1;
+    if (cfg.window < 1) cfg.window = 1;
+    if (duration <= 0 && !g_limit) duration = 10;
+    g_closed_loop = rate <= 0;
+    srand((unsigned)time(NULL));
+
+    g_client = lc_create(&cfg);
+    if (!g_client) { fprintf(stderr, "cannot resolve server address\n"); return 1; }
+
+    if (g_closed_loop) {
+        printf("closed loop: %d connections x %d outstanding\n", cfg.connections, cfg.window);
+    } else {
+        printf("open loop: %.1f cmds/s (%s) over %d connections\n", rate,
+               poisson ? "poisson" : "fixed interval", cfg.connections);
+    }
+    fflush(stdout);
+
+    double t0 = now_us(), deadline = duration > 0 ? t0 + duration * 1e6 : 0;
+    double next_arrival = t0;
+    if (g_closed_loop) {
+        for (int i = 0; i < cfg.connections * cfg.window && !g_stop; i++) submit(t0);
+    }
+
+    while (!g_stop || lc_pending(g_client) > 0) {
+        double now = now_us();
+        if (!g_stop && deadline && now >= deadline) g_stop = true;
+        int timeout_ms = 100;
+        if (!g_closed_loop && !g_stop) {
+            // Send every arrival that is due, stamped with its scheduled time
+            while (!g_stop && next_arrival <= now) {
+                submit(next_arrival);
+                double gap = 1e6 / rate;
+                if (poisson) gap = -log(1.0 - rand() / (RAND_MAX + 1.0)) * gap;
+                next_arrival += gap;
+            }
+            timeout_ms = (int)((next_arrival - now_us()) / 1e3);
+            if (timeout_ms < 0) timeout_ms = 0;
+        }
+        if (lc_process(g_client, timeout_ms) < 0) break;
+    }
+    double elapsed = (now_us() - t0) / 1e6;
+
+    printf("%lu commands in %.2f s: %.1f cmds/s completed\n", g_completed, elapsed,
+           g_ok / elapsed);
+    printf("  ok %lu (exit != 0: %lu)  busy %lu  errors %lu\n", g_ok, g_nonzero, g_busy, g_err);
+    for (int i = 0; i < g_nmix; i++) {
+        printf("  %6lu x %s\n", g_mix[i].done, g_mix[i].cmd);
+    }
+    report("connect", &g_connect);
+    report("queue wait", &g_queue);
+    report("completion", &g_complete);
+    lc_destroy(g_client);
+    return g_err ? 2 : 0;
+}
@@ -0,0 +1,120 @@
+// lz.c - in-tree LZ77 codec (see lz.h for the block format)
+#include "lz.h"
+#include <stdint.h>
+#include <string.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+#define LZ_MAX_OFFSET 65535
+
+static uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint32_t hash4(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+size_t lz_bound(size_t n) {
+    return n + n / 255 + 16;
+}
+
+static uint8_t *put_len(uint8_t *op, size_t len) {
+    while (len >= 255) { *op++ = 255; len -= 255; }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+// Appends one sequence; a NULL `match` writes the final literals-only one
+static uint8_t *put_seq(uint8_t *op, uint8_t *oend, const uint8_t *lit, size_t nlit,
+                        const uint8_t *match, size_t off, size_t mlen) {
+    if ((size_t)(oend - op) < 1 + nlit / 255 + 1 + nlit + 2 + mlen / 255 + 1) return NULL;
+
+    uint8_t *token = op++;
+    *token = (uint8_t)((nlit >= 15 ? 15 : nlit) << 4);
+    if (nlit >= 15) op = put_len(op, nlit - 15);
+    memcpy(op, lit, nlit);
+    op += nlit;
+    if (!match) return op;
+
+    *op++ = (uint8_t)(off & 0xff);
+    *op++ = (uint8_t)(off >> 8);
+    mlen -= LZ_MIN_MATCH;
+    *token |= (uint8_t)(mlen >= 15 ? 15 : mlen);
+    if (mlen >= 15) op = put_len(op, mlen - 15);
+    return op;
+}
+
+size_t lz_compress(const void *src, size_t n, void *dst, size_t cap) {
+    const uint8_t *in = src, *ip = in, *anchor = in, *end = in + n;
+    uint8_t *op = dst, *oend = op + cap;
+    uint32_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    while (end - ip >= LZ_MIN_MATCH) {
+        uint32_t seq = read32(ip);
+        uint32_t h = hash4(seq);
+        const uint8_t *ref = in + table[h];
+        table[h] = (uint32_t)(ip - in);
+
+        if (ref < ip && ip - ref <= LZ_MAX_OFFSET && read32(ref) == seq) {
+            const uint8_t *mp = ip + LZ_MIN_MATCH, *rp = ref + LZ_MIN_MATCH;
+            while (mp < end && *mp == *rp) { mp++; rp++; }
+            op = put_seq(op, oend, anchor, ip - anchor, ref, ip - ref, mp - ip);
+            if (!op) return 0;
+            ip = anchor = mp;
+        } else {
+            // Skip faster through data that keeps not matching
+            ip += 1 + ((ip - anchor) >> 6);
+        }
+    }
+    op = put_seq(op, oend, anchor, end - anchor, NULL, 0, 0);
+    return op ? (size_t)(op - (uint8_t *)dst) : 0;
+}
+
+// Reads an extended length; -1 if the input runs out
+static long get_len(const uint8_t **ip, const uint8_t *iend, size_t base) {
+    size_t len = base;
+    if (base < 15) return (long)len;
+    uint8_t b;
+    do {
+        if (*ip >= iend) return -1;
+        b = *(*ip)++;
+        len += b;
+    } while (b == 255);
+    return (long)len;
+}
+
+long lz_decompress(const void *src, size_t n, void *dst, size_t cap) {
+    const uint8_t *ip = src, *iend = ip + n;
+    uint8_t *op = dst, *ostart = dst, *oend = op + cap;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+        long nlit = get_len(&ip, iend, token >> 4);
+        if (nlit < 0 || nlit > iend - ip || nlit > oend - op) return -1;
+        memcpy(op, ip, nlit);
+        ip += nlit;
+        op += nlit;
+        if (ip == iend) break;  // last sequence
+
+        if (iend - ip < 2) return -1;
+        size_t off = ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        long mlen = get_len(&ip, iend, token & 15);
+        if (mlen < 0) return -1;
+        mlen += LZ_MIN_MATCH;
+        if (off == 0 || off > (size_t)(op - ostart) || mlen > oend - op) return -1;
+
+        const uint8_t *ref = op - off;
+        if (off >= (size_t)mlen) {
+            memcpy(op, ref, mlen);
+            op += mlen;
+        } else {
+            while (mlen--) *op++ = *ref++;  // overlapping: repeats the pattern
+        }
+    }
+    return (long)(op - ostart);
+}
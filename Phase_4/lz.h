@@ -0,0 +1,25 @@
+#ifndef LZ_H
+#define LZ_H
+#include <stddef.h>
+
+// ---------------------------------------------------------------------------
+// Small LZ77 block codec (LZ4-style sequences) for compressing output frames.
+// A block is a list of sequences:
+//   [token][literal len ext...][literals][u16 LE offset][match len ext...]
+// token = literal length (high nibble) | match length - 4 (low nibble); a
+// nibble of 15 continues in extension bytes (255 = keep adding). The last
+// sequence has literals only and ends the block.
+// ---------------------------------------------------------------------------
+
+// Worst-case compressed size for n input bytes
+size_t lz_bound(size_t n);
+
+// Compresses src into dst. Returns the compressed size, or 0 if it does
+// not fit in `cap` (callers then send the data raw).
+size_t lz_compress(const void *src, size_t n, void *dst, size_t cap);
+
+// Returns the decompressed size, or -1 if the block is malformed or would
+// not fit in `cap`.
+long lz_decompress(const void *src, size_t n, void *dst, size_t cap);
+
+#endif
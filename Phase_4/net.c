@@ -3,17 +3,31 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <netdb.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <unistd.h>
 
+// Blocks until a non-blocking fd is ready, so readn/writen keep their
+// "exactly n bytes" contract on sockets owned by an event loop.
+static void wait_fd(int fd, short events) {
+    struct pollfd p = { .fd = fd, .events = events };
+    while (poll(&p, 1, -1) < 0 && errno == EINTR) {}
+}
+
 ssize_t readn(int fd, void *buf, size_t n) {
     size_t left = n; char *p = buf;
     while (left > 0) {
         ssize_t r = read(fd, p, left);
         if (r == 0) return (ssize_t)(n - left); // EOF
-        if (r < 0) { if (errno == EINTR) continue; return -1; }
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) { wait_fd(fd, POLLIN); continue; }
+            return -1;
+        }
         left -= r; p += r;
     }
     return (ssize_t)n;
@@ -23,16 +37,47 @@ ssize_t writen(int fd, const void *buf, size_t n) {
     size_t left = n; const char *p = buf;
     while (left > 0) {
         ssize_t r = write(fd, p, left);
-        if (r <= 0) { if (r < 0 && errno == EINTR) continue; return -1; }
+        if (r <= 0) {
+            if (r < 0 && errno == EINTR) continue;
+            if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { wait_fd(fd, POLLOUT); continue; }
+            return -1;
+        }
         left -= r; p += r;
     }
     return (ssize_t)n;
 }
 
+ssize_t writevn(int fd, struct iovec *iov, int iovcnt) {
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) total += iov[i].iov_len;
+    size_t left = total;
+    while (left > 0) {
+        ssize_t r = writev(fd, iov, iovcnt);
+        if (r <= 0) {
+            if (r < 0 && errno == EINTR) continue;
+            if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { wait_fd(fd, POLLOUT); continue; }
+            return -1;
+        }
+        left -= r;
+        // skip fully written iovecs, trim the partially written one
+        while (iovcnt > 0 && (size_t)r >= iov->iov_len) { r -= iov->iov_len; iov++; iovcnt--; }
+        if (iovcnt > 0) { iov->iov_base = (char *)iov->iov_base + r; iov->iov_len -= r; }
+    }
+    return (ssize_t)total;
+}
+
 int tcp_listen(uint16_t port) {
-    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    return tcp_listen_backlog(port, TCP_DEFAULT_BACKLOG, false);
+}
+
+int tcp_listen_backlog(uint16_t port, int backlog, bool reuseport) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
     if (fd < 0) return -1;
     int yes = 1; setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    if (reuseport && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) < 0) {
+        close(fd);
+        return -1;
+    }
 
     struct sockaddr_in addr = {0};
     addr.sin_family = AF_INET;
@@ -40,10 +85,21 @@ int tcp_listen(uint16_t port) {
     addr.sin_port = htons(port);
 
     if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) { close(fd); return -1; }
-    if (listen(fd, 16) < 0) { close(fd); return -1; }
+    if (listen(fd, backlog) < 0) { close(fd); return -1; }  // capped by net.core.somaxconn
     return fd;
 }
 
+int tcp_listen_shards(uint16_t port, int backlog, int n, int *fds) {
+    for (int i = 0; i < n; i++) {
+        fds[i] = tcp_listen_backlog(port, backlog, true);
+        if (fds[i] < 0) {
+            while (i > 0) close(fds[--i]);
+            return -1;
+        }
+    }
+    return n;
+}
+
 int tcp_connect(const char *host, uint16_t port) {
     struct addrinfo hints = {0}, *res = NULL;
     hints.ai_family = AF_INET; hints.ai_socktype = SOCK_STREAM;
@@ -60,3 +116,54 @@ int tcp_connect(const char *host, uint16_t port) {
     freeaddrinfo(res);
     return -1;
 }
+
+static int unix_addr(const char *path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) { errno = ENAMETOOLONG; return -1; }
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+int unix_listen(const char *path, int backlog) {
+    struct sockaddr_un addr;
+    if (unix_addr(path, &addr) < 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    unlink(path);  // left over from a previous run
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) { close(fd); return -1; }
+    if (listen(fd, backlog) < 0) { close(fd); return -1; }
+    return fd;
+}
+
+int unix_connect(const char *path) {
+    struct sockaddr_un addr;
+    if (unix_addr(path, &addr) < 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) { close(fd); return -1; }
+    return fd;
+}
+
+ssize_t send_fds(int sock, const void *buf, size_t len, const int *fds, int nfds) {
+    char ctl[CMSG_SPACE(sizeof(int) * 8)];
+    if (nfds < 1 || nfds > 8 || len == 0) { errno = EINVAL; return -1; }
+    memset(ctl, 0, sizeof(ctl));
+
+    struct iovec iov = { (void *)buf, len };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+                          .msg_control = ctl, .msg_controllen = CMSG_SPACE(sizeof(int) * nfds) };
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+    memcpy(CMSG_DATA(c), fds, sizeof(int) * nfds);
+
+    ssize_t r;
+    while ((r = sendmsg(sock, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR) {}
+    if (r < 0) return -1;
+    // The descriptors went with the first chunk; the rest is plain data
+    if ((size_t)r < len && writen(sock, (const char *)buf + r, len - r) < 0) return -1;
+    return (ssize_t)len;
+}
@@ -1,9 +1,24 @@
 #pragma once
 #include <stdint.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+
+#include <stdbool.h>
+
+#define TCP_DEFAULT_BACKLOG 16
 
 int tcp_listen(uint16_t port);                     // returns listening fd
+int tcp_listen_backlog(uint16_t port, int backlog, bool reuseport);
+// Sharded acceptors: opens `n` SO_REUSEPORT listeners on the same port into
+// fds[] (the kernel spreads new connections across them). Returns n or -1.
+int tcp_listen_shards(uint16_t port, int backlog, int n, int *fds);
 int tcp_connect(const char *host, uint16_t port);  // returns connected fd
+int unix_listen(const char *path, int backlog);    // AF_UNIX listener (replaces a stale socket file)
+int unix_connect(const char *path);
+
+// Sends buf (all of it) with `fds` attached as SCM_RIGHTS on its first byte
+ssize_t send_fds(int sock, const void *buf, size_t len, const int *fds, int nfds);
 
 ssize_t readn(int fd, void *buf, size_t n);        // read exactly n bytes or fail
-ssize_t writen(int fd, const void *buf, size_t n); // write exactly n bytes or fail
\ No newline at end of file
+ssize_t writen(int fd, const void *buf, size_t n); // write exactly n bytes or fail
+ssize_t writevn(int fd, struct iovec *iov, int iovcnt); // writev all iovecs or fail (iov is modified)
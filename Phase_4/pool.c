@@ -0,0 +1,199 @@
+// pool.c - bounded, self-sizing worker pool (see pool.h)
+#include "pool.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+    size_t seq;                   // ring protocol: whose turn this slot is
+    void (*fn)(void *);
+    void *arg;
+} Slot;
+
+struct WorkerPool {
+    // Vyukov-style MPMC ring: producers claim `tail`, consumers `head`, and
+    // each slot's seq says whether it is free or holds a task.
+    Slot ring[POOL_QUEUE_SIZE];
+    size_t head, tail;
+    sem_t items;                  // queued tasks not yet claimed by a worker
+
+    int min, max, idle_ms;
+    pthread_attr_t attr;
+    int threads, peak;
+    // Waiting workers minus tasks already promised to them. A submit that
+    // takes it to <= 0 found nobody free and starts a worker.
+    int spare;
+    int load;                     // tasks queued or running, at most `max`
+    void (*done)(void *);         // pool_set_done() hook
+    void *done_arg;
+    unsigned long tasks, created;
+};
+
+static int ring_push(WorkerPool *p, void (*fn)(void *), void *arg) {
+    size_t pos = __atomic_load_n(&p->tail, __ATOMIC_RELAXED);
+    for (;;) {
+        Slot *s = &p->ring[pos & (POOL_QUEUE_SIZE - 1)];
+        size_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        long diff = (long)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&p->tail, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                s->fn = fn;
+                s->arg = arg;
+                __atomic_store_n(&s->seq, pos + 1, __ATOMIC_RELEASE);
+                return 0;
+            }
+        } else if (diff < 0) {
+            return -1;  // full
+        } else {
+            pos = __atomic_load_n(&p->tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static int ring_pop(WorkerPool *p, void (**fn)(void *), void **arg) {
+    size_t pos = __atomic_load_n(&p->head, __ATOMIC_RELAXED);
+    for (;;) {
+        Slot *s = &p->ring[pos & (POOL_QUEUE_SIZE - 1)];
+        size_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        long diff = (long)(seq - (pos + 1));
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&p->head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *fn = s->fn;
+                *arg = s->arg;
+                __atomic_store_n(&s->seq, pos + POOL_QUEUE_SIZE, __ATOMIC_RELEASE);
+                return 0;
+            }
+        } else if (diff < 0) {
+            return -1;  // empty
+        } else {
+            pos = __atomic_load_n(&p->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// Leaves the pool if there are more than `min` workers
+static int try_retire(WorkerPool *p) {
+    int n = __atomic_load_n(&p->threads, __ATOMIC_RELAXED);
+    while (n > p->min) {
+        if (__atomic_compare_exchange_n(&p->threads, &n, n - 1, false,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void *worker_main(void *arg) {
+    WorkerPool *p = arg;
+    for (;;) {
+        __atomic_add_fetch(&p->spare, 1, __ATOMIC_ACQ_REL);
+wait:;
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += p->idle_ms / 1000;
+        deadline.tv_nsec += (long)(p->idle_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) { deadline.tv_sec++; deadline.tv_nsec -= 1000000000; }
+
+        int rc;
+        while ((rc = sem_timedwait(&p->items, &deadline)) < 0 && errno == EINTR) {}
+
+        if (rc < 0) {
+            // Timed out. Take our spare slot back unless a submit already
+            // counted on us, in which case its task is on the way.
+            int s = __atomic_load_n(&p->spare, __ATOMIC_ACQUIRE);
+            do {
+                if (s <= 0) goto wait;
+            } while (!__atomic_compare_exchange_n(&p->spare, &s, s - 1, false,
+                                                  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+            if (try_retire(p)) return NULL;
+            continue;
+        }
+        void (*fn)(void *);
+        void *farg;
+        // The semaphore count guarantees a task, but a producer may still be
+        // between claiming its slot and publishing it
+        while (ring_pop(p, &fn, &farg) < 0) sched_yield();
+        __atomic_add_fetch(&p->tasks, 1, __ATOMIC_RELAXED);
+        fn(farg);
+        __atomic_sub_fetch(&p->load, 1, __ATOMIC_RELEASE);
+        if (p->done) p->done(p->done_arg);
+    }
+}
+
+// Starts one worker if we are still below `max`
+static void grow(WorkerPool *p) {
+    int n = __atomic_load_n(&p->threads, __ATOMIC_RELAXED);
+    while (n < p->max) {
+        if (!__atomic_compare_exchange_n(&p->threads, &n, n + 1, false,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            continue;
+        }
+        pthread_t tid;
+        if (pthread_create(&tid, &p->attr, worker_main, p) != 0) {
+            __atomic_sub_fetch(&p->threads, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        __atomic_add_fetch(&p->created, 1, __ATOMIC_RELAXED);
+        int peak = __atomic_load_n(&p->peak, __ATOMIC_RELAXED);
+        while (n + 1 > peak &&
+               !__atomic_compare_exchange_n(&p->peak, &peak, n + 1, false,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+        return;
+    }
+}
+
+WorkerPool *pool_create(int min, int max, size_t stack_size, int idle_ms) {
+    WorkerPool *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    if (min < 0) min = 0;
+    if (max < 1) max = 1;
+    if (min > max) min = max;
+    p->min = min;
+    p->max = max;
+    p->idle_ms = idle_ms > 0 ? idle_ms : 1;
+    for (size_t i = 0; i < POOL_QUEUE_SIZE; i++) p->ring[i].seq = i;
+    sem_init(&p->items, 0, 0);
+
+    pthread_attr_init(&p->attr);
+    pthread_attr_setdetachstate(&p->attr, PTHREAD_CREATE_DETACHED);
+    if (stack_size > 0) pthread_attr_setstacksize(&p->attr, stack_size);
+
+    for (int i = 0; i < min; i++) grow(p);
+    return p;
+}
+
+int pool_submit(WorkerPool *p, void (*fn)(void *), void *arg) {
+    // A task holds its worker for as long as it runs (a connection, a
+    // blocked command): one that can't get a worker now is refused rather
+    // than left in the ring until some other task ends
+    if (__atomic_add_fetch(&p->load, 1, __ATOMIC_ACQ_REL) > p->max) {
+        __atomic_sub_fetch(&p->load, 1, __ATOMIC_RELEASE);
+        return -1;
+    }
+    if (ring_push(p, fn, arg) < 0) {
+        __atomic_sub_fetch(&p->load, 1, __ATOMIC_RELEASE);
+        return -1;
+    }
+    sem_post(&p->items);
+    // Nobody free to pick it up right away: add a worker (up to max)
+    if (__atomic_fetch_sub(&p->spare, 1, __ATOMIC_ACQ_REL) <= 0) grow(p);
+    return 0;
+}
+
+void pool_set_done(WorkerPool *p, void (*done)(void *), void *arg) {
+    p->done = done;
+    p->done_arg = arg;
+}
+
+void pool_stats(WorkerPool *p, PoolStats *out) {
+    out->tasks = __atomic_load_n(&p->tasks, __ATOMIC_RELAXED);
+    out->threads_created = __atomic_load_n(&p->created, __ATOMIC_RELAXED);
+    out->threads = __atomic_load_n(&p->threads, __ATOMIC_RELAXED);
+    out->peak_threads = __atomic_load_n(&p->peak, __ATOMIC_RELAXED);
+}
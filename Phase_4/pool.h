@@ -0,0 +1,37 @@
+#ifndef POOL_H
+#define POOL_H
+#include <stddef.h>
+
+// ---------------------------------------------------------------------------
+// Worker pool for connection handling. Acceptors hand work over through a
+// bounded lock-free MPMC ring; idle workers sleep on a semaphore. The pool
+// starts with `min` threads, grows up to `max` when a task arrives and no
+// worker is idle, and workers idle for `idle_ms` retire down to `min`.
+// ---------------------------------------------------------------------------
+
+#define POOL_QUEUE_SIZE 4096   // pending tasks (power of two)
+
+typedef struct WorkerPool WorkerPool;
+
+typedef struct {
+    unsigned long tasks;          // tasks handed to a worker
+    unsigned long threads_created;
+    int threads;                  // alive right now
+    int peak_threads;
+} PoolStats;
+
+// stack_size 0 = default pthread stack
+WorkerPool *pool_create(int min, int max, size_t stack_size, int idle_ms);
+
+// Queues fn(arg) for a worker. Returns -1 if `max` tasks are already
+// queued or running (or the queue is full): it would only wait.
+int pool_submit(WorkerPool *p, void (*fn)(void *), void *arg);
+
+// Calls done(arg) on the worker after every task, once that task no longer
+// counts towards `max`: a submit made from the hook, or after it, is not
+// refused for that task's sake. Set it before the first submit.
+void pool_set_done(WorkerPool *p, void (*done)(void *), void *arg);
+
+void pool_stats(WorkerPool *p, PoolStats *out);
+
+#endif
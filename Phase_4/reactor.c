@@ -0,0 +1,344 @@
+// reactor.c - epoll based connection handling (--mode=reactor)
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <pthread.h>
+#include "reactor.h"
+#include "server.h"
+#include "scheduler.h"
+#include "record.h"
+
+#define MAX_EVENTS 256
+
+struct Reactor;
+
+// Per-connection state. Only the owning reactor thread touches it.
+typedef struct Conn {
+    int fd;
+    int id;
+    char prefix[16];            // "[id]" for log lines
+    struct Reactor *r;
+    FrameWriter fw;
+    FrameReader fr;
+
+    int inflight;               // jobs from this connection queued/running
+    bool paused;                // EPOLLIN is off until a job finishes
+    bool closing;               // peer went away while jobs were in flight
+} Conn;
+
+// A Job plus the connection it came from. Every job in the queue is one of
+// these in reactor mode, so the executor can map a Job* back to its Conn.
+typedef struct ReactorJob {
+    Job job;
+    Conn *conn;
+    char *owned_cmd;            // copy of the command on mux connections
+    struct ReactorJob *next_done;
+} ReactorJob;
+
+typedef struct Reactor {
+    int epfd;
+    int evfd;                   // signalled by the executor when a job ends
+    pthread_mutex_t done_lock;
+    ReactorJob *done;           // finished jobs, handed back under done_lock
+    pthread_t tid;
+} Reactor;
+
+static Reactor *g_reactors;
+static int g_nreactors;
+
+static void conn_free(Conn *c) {
+    close(c->fd);
+    conn_release();
+    record_event(REC_CLOSE, c->id, 0, 0, NULL, 0);
+    fw_destroy(&c->fw);
+    fr_destroy(&c->fr);
+    free(c);
+}
+
+// Jobs still in flight keep using the writer, so the last one to finish
+// frees the connection instead (see on_jobs_done).
+static void conn_close(Conn *c) {
+    epoll_ctl(c->r->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    if (c->inflight > 0) c->closing = true;
+    else conn_free(c);
+}
+
+static void conn_set_events(Conn *c, uint32_t events) {
+    struct epoll_event ev = { .events = events, .data.ptr = c };
+    epoll_ctl(c->r->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+// V1 connections run one command at a time (and the running command still
+// points into the reader's buffer); mux connections get a window.
+static bool conn_can_read(Conn *c) {
+    if (c->fr.fmt != FRAME_V1) return c->inflight < g_cfg.max_inflight;
+    return c->inflight == 0;
+}
+
+// Hands one command to the scheduler, same as client_thread_func does.
+static void submit_command(Conn *c, FrameView *v, char *cmd) {
+    ReactorJob *rj = malloc(sizeof(*rj));
+    if (rj) {
+        rj->conn = c;
+        rj->owned_cmd = NULL;
+        // The reader keeps parsing past a mux frame, so keep our own copy
+        if (c->fr.fmt != FRAME_V1) rj->owned_cmd = cmd = strdup(cmd);
+    }
+    if (!rj || !cmd) {
+        free(rj);
+        fw_send_tagged(&c->fw, v->req_id, NULL, 0);  // could not run it: just end it
+        fw_flush(&c->fw);
+        return;
+    }
+    job_setup(&rj->job, c->id, c->fd, &c->fw, cmd);
+    rj->job.req_id = v->req_id;
+
+    pthread_mutex_lock(&sched_lock);
+    AdmitResult r = admit_job(&rj->job);
+    if (r != ADMIT_OK) {
+        unsigned retry = admit_retry_ms(r, &rj->job);
+        pthread_mutex_unlock(&sched_lock);
+        reject_job(&rj->job, r, retry);
+        free(rj->owned_cmd);
+        free(rj);
+        return;
+    }
+    if (rj->job.is_shell_cmd) {
+        log_line_prefixed("INFO", c->prefix, "--- created (-1)");
+    }
+    pthread_cond_broadcast(&sched_cond);
+    pthread_mutex_unlock(&sched_lock);
+
+    c->inflight++;
+}
+
+// Parses as many complete frames as possible out of the receive buffer.
+// Returns -1 if the connection was closed ("exit" or a bad frame).
+static int process_frames(Conn *c) {
+    FrameView v;
+    int rc;
+    while (conn_can_read(c) && (rc = fr_next(&c->fr, &v)) != 0) {
+        if (rc < 0) {
+            log_line_prefixed("ERROR", c->prefix, "recv_frame_str failed: %s", strerror(errno));
+            conn_close(c);
+            return -1;
+        }
+        record_event(REC_FRAME, c->id, v.req_id, v.type, v.data, v.len);
+        if (v.len > 0 && v.data[0] == '\0') {
+            handle_control_frame(&v, &c->fr, &c->fw, c->prefix);
+            continue;
+        }
+        char *cmd = command_from_frame(&v);
+        log_line_prefixed("RECEIVED", c->prefix, ">>> %s", cmd);
+
+        if (strcmp(cmd, "exit") == 0) {
+            conn_close(c);
+            return -1;
+        }
+        submit_command(c, &v, cmd);
+    }
+    if (!conn_can_read(c) && !c->paused) {
+        // Stop reading until a job finishes
+        c->paused = true;
+        conn_set_events(c, 0);
+    }
+    return 0;
+}
+
+static void on_readable(Conn *c) {
+    bool eof = false;
+    // Drain the socket, parsing as we go so the buffer never needs to hold
+    // more than one frame's worth of backlog.
+    while (conn_can_read(c)) {
+        ssize_t r = fr_fill(&c->fr, false);
+        if (r > 0) {
+            if (process_frames(c) < 0) return;
+            continue;
+        }
+        if (r == 0) { eof = true; break; }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        log_line_prefixed("ERROR", c->prefix, "recv_frame_str failed: %s", strerror(errno));
+        eof = true;
+        break;
+    }
+
+    if (eof) {
+        if (c->inflight == 0) log_line_prefixed("INFO", c->prefix, "client disconnected");
+        conn_close(c);
+    }
+}
+
+// Picks up jobs the executor finished and resumes their connections.
+static void on_jobs_done(Reactor *r) {
+    uint64_t n;
+    (void)read(r->evfd, &n, sizeof(n));
+
+    pthread_mutex_lock(&r->done_lock);
+    ReactorJob *list = r->done;
+    r->done = NULL;
+    pthread_mutex_unlock(&r->done_lock);
+
+    while (list) {
+        ReactorJob *rj = list;
+        list = rj->next_done;
+        Conn *c = rj->conn;
+        free(rj->owned_cmd);
+        free(rj);
+
+        c->inflight--;
+        if (c->closing) {
+            if (c->inflight == 0) {
+                log_line_prefixed("INFO", c->prefix, "client disconnected");
+                conn_free(c);
+            }
+            continue;
+        }
+        if (c->paused && conn_can_read(c)) {
+            c->paused = false;
+            conn_set_events(c, EPOLLIN);
+            process_frames(c);  // commands that arrived while we were paused
+        }
+    }
+}
+
+static void *reactor_thread_func(void *arg) {
+    Reactor *r = arg;
+    struct epoll_event evs[MAX_EVENTS];
+    for (;;) {
+        int n = epoll_wait(r->epfd, evs, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            return NULL;
+        }
+        for (int i = 0; i < n; i++) {
+            Conn *c = evs[i].data.ptr;
+            if (!c) { on_jobs_done(r); continue; }
+
+            if (c->paused && (evs[i].events & (EPOLLHUP | EPOLLERR))) {
+                // Not reading while paused, but the peer is gone.
+                conn_close(c);
+                continue;
+            }
+            on_readable(c);
+        }
+    }
+    return NULL;
+}
+
+// Executor: plays the part of the scheduler thread and of every blocked
+// client thread in threads mode. Only one job owns a CPU at a time, so one
+// thread per CPU is enough to run them; `arg` is the CPU index.
+static void *executor_thread_func(void *arg) {
+    int cpu = (int)(intptr_t)arg;
+    for (;;) {
+        pthread_mutex_lock(&sched_lock);
+        while (!cpu_can_run(cpu)) {
+            pthread_cond_wait(&sched_cond, &sched_lock);
+        }
+        Job *job = get_next_job(cpu);
+        if (!job) { pthread_mutex_unlock(&sched_lock); continue; }
+        job->my_turn = true;
+        pthread_mutex_unlock(&sched_lock);
+
+        run_job_slice(job);
+
+        pthread_mutex_lock(&sched_lock);
+        job->my_turn = false;
+        bool done = (job->status == JOB_FINISHED);
+        slice_done(job);
+        bool empty = (queued_jobs == 0);
+        // Another CPU may now steal what is queued here
+        pthread_cond_broadcast(&sched_cond);
+        pthread_mutex_unlock(&sched_lock);
+
+        if (!done) continue;
+
+        // The connection's reactor frees the job (and may resume reading)
+        ReactorJob *rj = (ReactorJob *)job;
+        pthread_cond_destroy(&job->cond);
+
+        Reactor *r = rj->conn->r;
+        pthread_mutex_lock(&r->done_lock);
+        rj->next_done = r->done;
+        r->done = rj;
+        pthread_mutex_unlock(&r->done_lock);
+        uint64_t one = 1;
+        (void)write(r->evfd, &one, sizeof(one));
+
+        // If queue empty, print timeline
+        if (empty) print_timeline();
+    }
+    return NULL;
+}
+
+// Acceptor: spreads new connections round-robin over the event loops.
+static void *acceptor_thread_func(void *arg) {
+    int lfd = (int)(intptr_t)arg;
+    static unsigned next;
+    while (1) {
+        int cfd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (cfd < 0) {
+            if (errno == EMFILE || errno == ENFILE) usleep(1000);
+            continue;
+        }
+        if (!conn_admit(cfd)) { close(cfd); continue; }
+
+        Conn *c = calloc(1, sizeof(*c));
+        if (!c) { close(cfd); conn_release(); continue; }
+        c->fd = cfd;
+        fw_init(&c->fw, cfd);
+        fr_init(&c->fr, cfd, g_cfg.max_frame);
+        c->id = next_client_id();
+        snprintf(c->prefix, sizeof(c->prefix), "[%d]", c->id);
+        unsigned n = __atomic_fetch_add(&next, 1, __ATOMIC_RELAXED);
+        c->r = &g_reactors[n % (unsigned)g_nreactors];
+
+        log_line_prefixed("INFO", c->prefix, "<<< client connected");
+        record_event(REC_OPEN, c->id, 0, 0, NULL, 0);
+
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+        if (epoll_ctl(c->r->epfd, EPOLL_CTL_ADD, cfd, &ev) < 0) {
+            conn_free(c);
+        }
+    }
+    return NULL;
+}
+
+int reactor_run(const int *lfds, int nlfds, int nreactors) {
+    g_nreactors = nreactors;
+    g_reactors = calloc(nreactors, sizeof(Reactor));
+    if (!g_reactors) return 1;
+
+    for (int i = 0; i < nreactors; i++) {
+        Reactor *r = &g_reactors[i];
+        r->epfd = epoll_create1(EPOLL_CLOEXEC);
+        r->evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (r->epfd < 0 || r->evfd < 0) { perror("reactor setup"); return 1; }
+        pthread_mutex_init(&r->done_lock, NULL);
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+        epoll_ctl(r->epfd, EPOLL_CTL_ADD, r->evfd, &ev);
+        pthread_create(&r->tid, NULL, reactor_thread_func, r);
+    }
+
+    for (int i = 0; i < sched_ncpus; i++) {
+        pthread_t etid;
+        pthread_create(&etid, NULL, executor_thread_func, (void *)(intptr_t)i);
+    }
+
+    // One acceptor per listening socket; the first one runs here
+    for (int i = 1; i < nlfds; i++) {
+        pthread_t atid;
+        pthread_create(&atid, NULL, acceptor_thread_func, (void *)(intptr_t)lfds[i]);
+    }
+    acceptor_thread_func((void *)(intptr_t)lfds[0]);
+    return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+// Serves clients accepted on the `nlfds` listening sockets in `lfds` (TCP
+// and/or unix) from `nreactors` epoll event-loop threads plus one executor
+// thread per scheduler CPU that runs scheduled jobs. Frame parsing and job submission happen
+// on the event loops, so an idle connection costs a few hundred bytes
+// instead of a blocked thread.
+// Only returns on a setup failure (non-zero).
+int reactor_run(const int *lfds, int nlfds, int nreactors);
+
+#endif
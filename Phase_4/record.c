@@ -0,0 +1,107 @@
+// record.c - binary traffic log for --record (format in record.h)
+#define _GNU_SOURCE
+#include "record.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define REC_BUF_SIZE (64 * 1024)
+#define REC_FLUSH_US 1000000    // buffered events reach the file within ~1 s
+
+// Our own buffer and write(2) rather than stdio: forked children that exit()
+// would otherwise flush a copy of whatever was buffered.
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_fd = -1;
+static char *g_buf;
+static size_t g_used;
+static uint64_t g_start_us, g_flushed_us;
+static bool g_on;           // read without the lock for the fast "off" path
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+static void flush_locked(uint64_t now) {
+    size_t off = 0;
+    while (off < g_used) {
+        ssize_t w = write(g_fd, g_buf + off, g_used - off);
+        if (w <= 0) break;  // disk full etc.: drop the rest, keep serving
+        off += (size_t)w;
+    }
+    g_used = 0;
+    g_flushed_us = now;
+}
+
+static void append_locked(const void *data, size_t len, uint64_t now) {
+    if (g_used + len > REC_BUF_SIZE) flush_locked(now);
+    if (len > REC_BUF_SIZE) {
+        // Bigger than the buffer (a huge command): write it through
+        (void)!write(g_fd, data, len);
+        return;
+    }
+    memcpy(g_buf + g_used, data, len);
+    g_used += len;
+}
+
+int record_open(const char *path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+    char *buf = malloc(REC_BUF_SIZE);
+    if (!buf) { close(fd); return -1; }
+
+    char hdr[16] = REC_MAGIC;
+    uint32_t version = REC_VERSION;
+    memcpy(hdr + 8, &version, sizeof(version));
+
+    pthread_mutex_lock(&g_lock);
+    g_fd = fd;
+    g_buf = buf;
+    g_used = 0;
+    g_start_us = g_flushed_us = now_us();
+    append_locked(hdr, sizeof(hdr), g_start_us);
+    __atomic_store_n(&g_on, true, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_lock);
+    return 0;
+}
+
+void record_event(RecKind kind, int client_id, uint32_t req_id, uint8_t type,
+                  const void *data, uint32_t len) {
+    if (!__atomic_load_n(&g_on, __ATOMIC_ACQUIRE)) return;
+    RecEntry e;
+    memset(&e, 0, sizeof(e));
+    e.client_id = (uint32_t)client_id;
+    e.req_id = req_id;
+    e.kind = (uint8_t)kind;
+    e.type = type;
+    e.len = data ? len : 0;
+
+    pthread_mutex_lock(&g_lock);
+    if (g_fd >= 0) {
+        // Stamped under the lock, so the file is in time order
+        uint64_t now = now_us();
+        e.t_us = now - g_start_us;
+        append_locked(&e, sizeof(e), now);
+        if (e.len) append_locked(data, e.len, now);
+        if (now - g_flushed_us >= REC_FLUSH_US) flush_locked(now);
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void record_close(void) {
+    pthread_mutex_lock(&g_lock);
+    if (g_fd >= 0) {
+        __atomic_store_n(&g_on, false, __ATOMIC_RELEASE);
+        flush_locked(now_us());
+        close(g_fd);
+        g_fd = -1;
+        free(g_buf);
+        g_buf = NULL;
+    }
+    pthread_mutex_unlock(&g_lock);
+}
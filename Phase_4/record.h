@@ -0,0 +1,51 @@
+#ifndef RECORD_H
+#define RECORD_H
+#include <stdint.h>
+
+// ---------------------------------------------------------------------------
+// Traffic recording (server --record=FILE), read back by ./replay.
+//
+// The file is REC_MAGIC, a u32 version, a u32 zero, then one RecEntry per
+// event followed by `len` payload bytes. Everything is in host byte order;
+// a log is meant to be replayed on the machine (or kind) it came from.
+// Times are microseconds since the recording started.
+// ---------------------------------------------------------------------------
+
+#define REC_MAGIC "SCHEDREC"
+#define REC_VERSION 1
+
+typedef enum {
+    REC_OPEN = 1,   // connection accepted
+    REC_FRAME,      // frame received: payload as sent, control frames included
+    REC_DONE,       // command ended: RecDone payload
+    REC_BUSY,       // command turned away by admission control
+    REC_CLOSE       // connection closed
+} RecKind;
+
+typedef struct {
+    uint64_t t_us;
+    uint32_t client_id;
+    uint32_t req_id;        // frame tag (0 on plain v1 connections)
+    uint8_t kind;           // RecKind
+    uint8_t type;           // REC_FRAME: frame type (FT_CMD unless v2 says so)
+    uint16_t reserved;
+    uint32_t len;           // payload bytes that follow
+} RecEntry;
+
+typedef struct {
+    int32_t exit_code;
+    uint32_t reserved;
+    uint64_t queue_us, run_us, total_us;  // as in the timing trailer
+} RecDone;
+
+// Starts recording to `path` (truncated). -1 on error.
+int record_open(const char *path);
+
+// Appends one event; a no-op unless recording. Thread-safe.
+void record_event(RecKind kind, int client_id, uint32_t req_id, uint8_t type,
+                  const void *data, uint32_t len);
+
+// Flushes and stops recording
+void record_close(void);
+
+#endif
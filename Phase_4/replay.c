@@ -0,0 +1,373 @@
+// replay.c - re-issues traffic recorded with `server --record=FILE`
+//
+// Every recorded connection becomes its own libclient connection, opened at
+// the time the original was accepted, and sends its commands at the times
+// the server originally received them, divided by --speed. The window of
+// each connection is the most commands it ever had in flight, so a plain
+// one-at-a-time client stays one-at-a-time and a multiplexed one keeps its
+// pipelining. Control frames (HELLO, STATS, ...) and "exit" are not
+// replayed; libclient does its own handshake.
+//
+// Afterwards it compares the recorded and replayed distributions of
+// turnaround (received -> END sent, from the server's timing) and queue
+// wait, plus the replayed completion time as the client saw it, measured
+// from the scheduled send time so backlog counts. Only arrivals are sped
+// up: a job still takes as many time units as it did.
+//
+// Usage: ./replay [-H host] [-p port | -s unix_path] [-x speed] FILE
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include "libclient.h"
+#include "record.h"
+#include "frame.h"
+
+typedef struct Conn Conn;
+
+typedef struct {
+    uint64_t t_us;              // received, in recorded time
+    char *cmd;
+    uint32_t req_id;
+    Conn *conn;
+    // Recorded outcome
+    bool rec_done, rec_busy;
+    RecDone rec;
+    // Replayed outcome
+    double sent_us;             // scheduled send time, wall clock
+    LcResult res;
+    double client_us;
+    bool replayed;
+} Cmd;
+
+struct Conn {
+    int client_id;
+    uint64_t open_us;
+    int *cmds, ncmds, cap;
+    int first_open;             // earliest command without a recorded end
+    int inflight, window;
+    LcClient *lc;
+    int submitted, done;
+};
+
+typedef struct {
+    double *v;
+    size_t n, cap;
+} Samples;
+
+static Cmd *g_cmds;
+static int g_ncmds, g_cmds_cap;
+static Conn **g_by_id;          // recorded client id -> connection
+static int g_ids_cap;
+static Conn **g_conns;          // in accept order
+static int g_nconns, g_conns_cap;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void *grow(void *p, int *cap, size_t elem) {
+    *cap = *cap ? *cap * 2 : 256;
+    p = realloc(p, (size_t)*cap * elem);
+    if (!p) { perror("realloc"); exit(1); }
+    return p;
+}
+
+static void sample_add(Samples *s, double v) {
+    if (s->n == s->cap) {
+        s->cap = s->cap ? s->cap * 2 : 1024;
+        s->v = realloc(s->v, s->cap * sizeof(double));
+        if (!s->v) { perror("realloc"); exit(1); }
+    }
+    s->v[s->n++] = v;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double pct(const Samples *s, double p) {
+    return s->v[(size_t)(s->n * p) < s->n ? (size_t)(s->n * p) : s->n - 1];
+}
+
+static void report(const char *name, Samples *s, const Samples *base) {
+    if (s->n == 0) { printf("  %-22s (no samples)\n", name); return; }
+    qsort(s->v, s->n, sizeof(double), cmp_double);
+    double sum = 0;
+    for (size_t i = 0; i < s->n; i++) sum += s->v[i];
+    printf("  %-22s %7zu %10.2f %10.2f %10.2f %10.2f %10.2f\n", name, s->n, sum / s->n / 1e3,
+           pct(s, 0.5) / 1e3, pct(s, 0.9) / 1e3, pct(s, 0.99) / 1e3, s->v[s->n - 1] / 1e3);
+    if (base && base->n) {
+        printf("  %-22s %7s %10s %+9.1f%% %+9.1f%% %+9.1f%% %+9.1f%%\n", "  vs recorded", "", "",
+               (pct(s, 0.5) - pct(base, 0.5)) * 100 / (pct(base, 0.5) + 1e-9),
+               (pct(s, 0.9) - pct(base, 0.9)) * 100 / (pct(base, 0.9) + 1e-9),
+               (pct(s, 0.99) - pct(base, 0.99)) * 100 / (pct(base, 0.99) + 1e-9),
+               (s->v[s->n - 1] - base->v[base->n - 1]) * 100 / (base->v[base->n - 1] + 1e-9));
+    }
+}
+
+static Conn *conn_get(int id, uint64_t t_us) {
+    if (id <= 0) return NULL;
+    while (id >= g_ids_cap) {
+        int old = g_ids_cap;
+        g_by_id = grow(g_by_id, &g_ids_cap, sizeof(Conn *));
+        memset(g_by_id + old, 0, (size_t)(g_ids_cap - old) * sizeof(Conn *));
+    }
+    if (!g_by_id[id]) {
+        // A frame without a recorded accept (recording started mid-session)
+        Conn *c = calloc(1, sizeof(*c));
+        if (!c) { perror("calloc"); exit(1); }
+        c->client_id = id;
+        c->open_us = t_us;
+        g_by_id[id] = c;
+        if (g_nconns == g_conns_cap) g_conns = grow(g_conns, &g_conns_cap, sizeof(Conn *));
+        g_conns[g_nconns++] = c;
+    }
+    return g_by_id[id];
+}
+
+static void add_cmd(Conn *c, const RecEntry *e, char *payload) {
+    if (e->len && payload[e->len - 1] == '\n') payload[e->len - 1] = '\0';
+    if (strcmp(payload, "exit") == 0) return;
+    if (g_ncmds == g_cmds_cap) g_cmds = grow(g_cmds, &g_cmds_cap, sizeof(Cmd));
+    Cmd *k = &g_cmds[g_ncmds];
+    memset(k, 0, sizeof(*k));
+    k->t_us = e->t_us;
+    k->cmd = strdup(payload);
+    k->req_id = e->req_id;
+    k->conn = c;
+    if (c->ncmds == c->cap) c->cmds = grow(c->cmds, &c->cap, sizeof(int));
+    c->cmds[c->ncmds++] = g_ncmds++;
+    if (++c->inflight > c->window) c->window = c->inflight;
+}
+
+// The command an end event belongs to: the oldest open one with its tag
+static Cmd *match_end(Conn *c, uint32_t req_id) {
+    for (int i = c->first_open; i < c->ncmds; i++) {
+        Cmd *k = &g_cmds[c->cmds[i]];
+        if (k->rec_done || k->rec_busy || k->req_id != req_id) continue;
+        if (i == c->first_open) c->first_open++;
+        c->inflight--;
+        return k;
+    }
+    return NULL;
+}
+
+static int load_log(const char *file) {
+    FILE *f = fopen(file, "rb");
+    if (!f) { perror(file); return -1; }
+    char hdr[16];
+    uint32_t version;
+    if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr) || memcmp(hdr, REC_MAGIC, 8) != 0) {
+        fprintf(stderr, "%s: not a recording\n", file);
+        fclose(f);
+        return -1;
+    }
+    memcpy(&version, hdr + 8, sizeof(version));
+    if (version != REC_VERSION) {
+        fprintf(stderr, "%s: recording version %u, expected %u\n", file, version, REC_VERSION);
+        fclose(f);
+        return -1;
+    }
+
+    RecEntry e;
+    char *payload = NULL;
+    size_t cap = 0;
+    while (fread(&e, sizeof(e), 1, f) == 1) {
+        if (e.len + 1 > cap) {
+            cap = e.len + 1;
+            payload = realloc(payload, cap);
+            if (!payload) { perror("realloc"); exit(1); }
+        }
+        if (e.len && fread(payload, 1, e.len, f) != e.len) break;  // cut short
+        payload[e.len] = '\0';
+
+        Conn *c = conn_get((int)e.client_id, e.t_us);
+        if (!c) continue;
+        switch (e.kind) {
+        case REC_OPEN:
+            c->open_us = e.t_us;
+            break;
+        case REC_FRAME:
+            // Commands only: control frames start with NUL
+            if (e.type == FT_CMD && e.len > 0 && payload[0] != '\0') add_cmd(c, &e, payload);
+            break;
+        case REC_DONE:
+        case REC_BUSY: {
+            Cmd *k = match_end(c, e.req_id);
+            if (!k) break;
+            if (e.kind == REC_BUSY) { k->rec_busy = true; break; }
+            k->rec_done = true;
+            if (e.len >= sizeof(RecDone)) memcpy(&k->rec, payload, sizeof(RecDone));
+            else k->rec.total_us = e.t_us - k->t_us;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    free(payload);
+    fclose(f);
+    return 0;
+}
+
+static void on_done(void *arg, const LcResult *res) {
+    Cmd *k = arg;
+    k->res = *res;
+    k->client_us = now_us() - k->sent_us;
+    k->replayed = true;
+    k->conn->done++;
+}
+
+// Connections with nothing left to send or wait for go away
+static void conn_maybe_close(Conn *cn, int ep, int *open) {
+    if (!cn->lc || cn->submitted < cn->ncmds || cn->done < cn->ncmds) return;
+    epoll_ctl(ep, EPOLL_CTL_DEL, lc_fd(cn->lc), NULL);
+    lc_destroy(cn->lc);
+    cn->lc = NULL;
+    (*open)--;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [options] FILE\n"
+        "  -H, --host=HOST       server host (127.0.0.1)\n"
+        "  -p, --port=PORT       server port (5050)\n"
+        "  -s, --unix=PATH       connect over a unix socket instead\n"
+        "  -x, --speed=N         arrivals N times faster than recorded (1; 0 = all at once)\n",
+        prog);
+}
+
+int main(int argc, char **argv) {
+    static const struct option opts[] = {
+        {"host",  required_argument, NULL, 'H'},
+        {"port",  required_argument, NULL, 'p'},
+        {"unix",  required_argument, NULL, 's'},
+        {"speed", required_argument, NULL, 'x'},
+        {"help",  no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    LcConfig base = { .connections = 1 };
+    double speed = 1;
+    int c;
+    while ((c = getopt_long(argc, argv, "H:p:s:x:h", opts, NULL)) != -1) {
+        switch (c) {
+        case 'H': base.host = optarg; break;
+        case 'p': base.port = (uint16_t)atoi(optarg); break;
+        case 's': base.unix_path = optarg; break;
+        case 'x': speed = atof(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (optind != argc - 1 || speed < 0) { usage(argv[0]); return 1; }
+    if (load_log(argv[optind]) < 0) return 1;
+    if (g_ncmds == 0) { fprintf(stderr, "no commands in %s\n", argv[optind]); return 1; }
+
+    int with_cmds = 0, max_window = 0;
+    for (int i = 0; i < g_nconns; i++) {
+        if (g_conns[i]->ncmds == 0) continue;
+        with_cmds++;
+        if (g_conns[i]->window > max_window) max_window = g_conns[i]->window;
+    }
+    printf("%d commands over %d connections (window up to %d), %.2f s recorded, speed %gx\n",
+           g_ncmds, with_cmds, max_window, g_cmds[g_ncmds - 1].t_us / 1e6, speed);
+    fflush(stdout);
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0) { perror("epoll_create1"); return 1; }
+    int next_conn = 0, next_cmd = 0, open = 0;
+    double t0 = now_us();
+    while (next_cmd < g_ncmds || open > 0) {
+        double now = now_us();
+        // Recorded time reached so far
+        double rec_now = speed > 0 ? (now - t0) * speed : 1e300;
+
+        while (next_conn < g_nconns && g_conns[next_conn]->open_us <= rec_now) {
+            Conn *cn = g_conns[next_conn++];
+            if (cn->ncmds == 0) continue;
+            LcConfig cfg = base;
+            cfg.window = cn->window > 0 ? cn->window : 1;
+            cn->lc = lc_create(&cfg);
+            if (!cn->lc) { fprintf(stderr, "cannot resolve server address\n"); return 1; }
+            struct epoll_event ev = { .events = EPOLLIN, .data.ptr = cn };
+            epoll_ctl(ep, EPOLL_CTL_ADD, lc_fd(cn->lc), &ev);
+            open++;
+        }
+        while (next_cmd < g_ncmds && g_cmds[next_cmd].t_us <= rec_now) {
+            Cmd *k = &g_cmds[next_cmd++];
+            k->sent_us = speed > 0 ? t0 + k->t_us / speed : now;
+            k->conn->submitted++;
+            lc_submit(k->conn->lc, k->cmd, NULL, on_done, k);
+            lc_process(k->conn->lc, 0);  // sends it
+            conn_maybe_close(k->conn, ep, &open);
+        }
+
+        int timeout = -1;
+        if (next_cmd < g_ncmds && speed > 0) {
+            double due = t0 + g_cmds[next_cmd].t_us / speed;
+            if (next_conn < g_nconns && t0 + g_conns[next_conn]->open_us / speed < due) {
+                due = t0 + g_conns[next_conn]->open_us / speed;
+            }
+            double left = due - now_us();
+            timeout = left > 0 ? (int)((left + 999) / 1e3) : 0;  // round up: no spinning
+        } else if (open == 0) {
+            break;  // the last connection closed on its final submit
+        }
+        struct epoll_event evs[64];
+        int n = epoll_wait(ep, evs, 64, timeout);
+        for (int i = 0; i < n; i++) {
+            Conn *cn = evs[i].data.ptr;
+            if (cn->lc) lc_process(cn->lc, 0);
+        }
+        for (int i = 0; i < n; i++) conn_maybe_close(evs[i].data.ptr, ep, &open);
+    }
+    double elapsed = (now_us() - t0) / 1e6;
+    close(ep);
+
+    Samples rec_total = { 0 }, rec_queue = { 0 }, rep_total = { 0 }, rep_queue = { 0 };
+    Samples rep_client = { 0 };
+    unsigned long rec_ok = 0, rec_busy = 0, rep_ok = 0, rep_busy = 0, rep_err = 0;
+    for (int i = 0; i < g_ncmds; i++) {
+        Cmd *k = &g_cmds[i];
+        if (k->rec_done) {
+            rec_ok++;
+            sample_add(&rec_total, (double)k->rec.total_us);
+            sample_add(&rec_queue, (double)k->rec.queue_us);
+        }
+        if (k->rec_busy) rec_busy++;
+        if (!k->replayed) continue;
+        switch (k->res.status) {
+        case LC_OK:
+            rep_ok++;
+            sample_add(&rep_client, k->client_us);
+            if (k->res.has_timing) {
+                sample_add(&rep_total, (double)k->res.total_us);
+                sample_add(&rep_queue, (double)k->res.queue_us);
+            }
+            break;
+        case LC_BUSY:     rep_busy++; break;
+        case LC_ERR_CONN: rep_err++; break;
+        }
+    }
+    printf("replayed in %.2f s\n", elapsed);
+    printf("  recorded: ok %lu  busy %lu  unfinished %lu\n", rec_ok, rec_busy,
+           g_ncmds - rec_ok - rec_busy);
+    printf("  replayed: ok %lu  busy %lu  errors %lu\n", rep_ok, rep_busy, rep_err);
+    printf("  %-22s %7s %10s %10s %10s %10s %10s\n", "(ms)", "n", "mean", "p50", "p90", "p99",
+           "max");
+    report("turnaround, recorded", &rec_total, NULL);
+    report("turnaround, replayed", &rep_total, &rec_total);
+    report("queue wait, recorded", &rec_queue, NULL);
+    report("queue wait, replayed", &rep_queue, &rec_queue);
+    report("client-side, replayed", &rep_client, NULL);
+    return rep_err ? 2 : 0;
+}
@@ -5,9 +5,12 @@
 
 pthread_mutex_t sched_lock = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t sched_cond = PTHREAD_COND_INITIALIZER;
-Job *job_queue = NULL;
-Job *current_job;
-bool cpu_busy;
+
+int sched_max_jobs = 0;
+int sched_max_work = 0;
+int sched_unit_ms = SCHED_UNIT_MS;
+int queued_jobs = 0;
+int sched_ncpus = 1;
 
 typedef struct TimelineEntry {
     int job_id;    // e.g., 1 => P1
@@ -15,115 +18,329 @@ typedef struct TimelineEntry {
     struct TimelineEntry *next;
 } TimelineEntry;
 
-static TimelineEntry *timeline_head = NULL;
-static TimelineEntry *timeline_tail = NULL;
+// One virtual CPU: its own run queue (a heap, see add_job()), the job it
+// is running and its own Gantt chart.
+typedef struct {
+    Job **heap;
+    int len, cap;
+    int work;               // queued_work summed over this heap
+    Job *current;           // NULL while the CPU is idle
+    // Track last scheduled job to prevent immediate re-selection (unless
+    // only 1 left). Jobs are told apart by seq, since one client can have
+    // several queued.
+    unsigned long last_seq;
+    TimelineEntry *tl_head, *tl_tail;
+} Cpu;
 
-// For the summary string at the bottom
-static char timeline_buffer[4096];
+static Cpu *cpus;
+static unsigned long next_job_seq = 0;
+static int queued_work_sum;     // sum of queued_work over all run queues
 
-// Track last scheduled job to prevent immediate re-selection (unless only 1 left)
-static int last_job_id = -1; 
+// Slices are appended by whoever ran them, without sched_lock
+static pthread_mutex_t timeline_lock = PTHREAD_MUTEX_INITIALIZER;
 
-void scheduler_init() {
-    timeline_buffer[0] = '\0';
+void scheduler_init(int ncpus) {
+    if (ncpus < 1) ncpus = 1;
+    cpus = calloc(ncpus, sizeof(Cpu));
+    if (!cpus) {
+        perror("scheduler_init");
+        abort();
+    }
+    sched_ncpus = ncpus;
 }
 
-void add_job(Job *j) {
-    j->next = NULL;
-    if (!job_queue) {
-        job_queue = j;
+
+static int job_work(const Job *j) {
+    return j->remaining_time > 0 ? j->remaining_time : 1;
+}
+
+// Sets the scheduling fields from the command text: a demo or other
+// ./program gets a burst, anything else runs as a shell command.
+void job_classify(Job *j, const char *cmd) {
+    if (strncmp(cmd, "./demo", 6) == 0 || strncmp(cmd, "demo", 4) == 0) {
+        // Known demo program: use N if provided, otherwise default
+        j->is_shell_cmd = false;
+
+        char *p = strchr(cmd, ' ');
+        if (p) j->total_time = atoi(p + 1);
+        else   j->total_time = DEFAULT_BURST;
+
+        j->remaining_time   = j->total_time;
+        j->burst_prediction = j->total_time;
+
+    } else if (strncmp(cmd, "./", 2) == 0) {
+        // Any other ./program. Only the wl_* workloads ("./wl_<kind> N ...")
+        // say how many units they run; for the rest (e.g., ./hello, or
+        // ./client 127.0.0.1) the burst is unknown -> default
+        j->is_shell_cmd     = false;
+        char *p = strchr(cmd, ' ');
+        int n = p && strncmp(cmd, "./wl_", 5) == 0 ? atoi(p + 1) : 0;
+        j->total_time       = n > 0 ? n : DEFAULT_BURST;
+        j->remaining_time   = j->total_time;
+        j->burst_prediction = j->total_time;
+
     } else {
-        Job *curr = job_queue;
-        while (curr->next) curr = curr->next;
-        curr->next = j;
+        // Plain shell / pipeline commands (pwd, ls, cat foo | grep bar, ... )
+        j->is_shell_cmd     = true;
+        j->total_time       = -1;
+        j->remaining_time   = -1;
+        j->burst_prediction = -1;  // "infinite priority" for scheduling
     }
-    // --- Preemption logic ---
-    // Only preempt if CPU is currently running a *program*.
-    if (cpu_busy && current_job && !current_job->is_shell_cmd) {
+}
+
+// Round-robin quantum of a program's next slice: 3 units on its first
+// round, 7 after that.
+int job_quantum(const Job *j) {
+    return j->rounds_run == 0 ? 3 : 7;
+}
 
-        bool new_has_priority = false;
+int queued_work(void) {
+    return queued_work_sum;
+}
 
-        // Shell commands always preempt running program
-        if (j->is_shell_cmd) {
-            new_has_priority = true;
-        }
-        // Otherwise, SRJF: shorter remaining time wins
-        else if (!j->is_shell_cmd &&
-                 j->remaining_time < current_job->remaining_time) {
-            new_has_priority = true;
+AdmitResult admit_job(Job *j) {
+    if (sched_max_jobs > 0 && queued_jobs >= sched_max_jobs) return ADMIT_TOO_MANY_JOBS;
+    if (sched_max_work > 0 && queued_work() + job_work(j) > sched_max_work) return ADMIT_TOO_MUCH_WORK;
+    add_job(j);
+    return ADMIT_OK;
+}
+
+// Roughly how long until the queue has room: one unit for a job slot,
+// or until enough queued work has run to fit this job, with all CPUs
+// working the queues off in parallel.
+unsigned admit_retry_ms(AdmitResult r, const Job *j) {
+    int units = 1;
+    if (r == ADMIT_TOO_MUCH_WORK) {
+        int excess = queued_work() + job_work(j) - sched_max_work;
+        units = (excess + sched_ncpus - 1) / sched_ncpus;
+        if (units < 1) units = 1;
+    }
+    return (unsigned)units * sched_unit_ms;
+}
+
+// ---------------------------------------------------------------------------
+// Run queues: one binary min-heap of Job pointers per CPU, each job knowing
+// its own CPU and slot (heap_idx), so insert, removal and re-keying are
+// O(log n). Order: shell commands first, then least remaining_time, then
+// arrival (seq) - the same choice the old list scan made. A job stays in
+// its CPU's heap while it runs, as it did in the single queue.
+// ---------------------------------------------------------------------------
+
+// Compares the remaining_time each job had when it was last (re)queued:
+// the running job counts down without the lock, and a key that moves under
+// the heap would break it.
+static bool job_before(const Job *a, const Job *b) {
+    if (a->is_shell_cmd != b->is_shell_cmd) return a->is_shell_cmd;
+    if (a->heap_key != b->heap_key) return a->heap_key < b->heap_key;
+    return a->seq < b->seq;
+}
+
+static void heap_set(Cpu *c, int i, Job *j) {
+    c->heap[i] = j;
+    j->heap_idx = i;
+}
+
+static void sift_up(Cpu *c, int i) {
+    Job *j = c->heap[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!job_before(j, c->heap[parent])) break;
+        heap_set(c, i, c->heap[parent]);
+        i = parent;
+    }
+    heap_set(c, i, j);
+}
+
+static void sift_down(Cpu *c, int i) {
+    Job *j = c->heap[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= c->len) break;
+        if (child + 1 < c->len && job_before(c->heap[child + 1], c->heap[child])) child++;
+        if (!job_before(c->heap[child], j)) break;
+        heap_set(c, i, c->heap[child]);
+        i = child;
+    }
+    heap_set(c, i, j);
+}
+
+static void heap_push(int cpu, Job *j) {
+    Cpu *c = &cpus[cpu];
+    if (c->len == c->cap) {
+        int cap = c->cap ? c->cap * 2 : 64;
+        Job **h = realloc(c->heap, sizeof(Job *) * cap);
+        if (!h) {
+            // Dropping the job would leave its client waiting forever
+            perror("add_job");
+            abort();
         }
+        c->heap = h;
+        c->cap = cap;
+    }
+    j->cpu = cpu;
+    c->work += j->queued_work;
+    c->heap[c->len] = j;
+    sift_up(c, c->len++);
+}
+
+static bool heap_remove(Job *j) {
+    if (j->cpu < 0 || j->cpu >= sched_ncpus) return false;
+    Cpu *c = &cpus[j->cpu];
+    int i = j->heap_idx;
+    if (i < 0 || i >= c->len || c->heap[i] != j) return false;
+    j->heap_idx = -1;
+    c->work -= j->queued_work;
+    Job *last = c->heap[--c->len];
+    if (i < c->len) {
+        // The last leaf fills the hole and moves whichever way it must
+        heap_set(c, i, last);
+        sift_up(c, i);
+        sift_down(c, last->heap_idx);
+    }
+    return true;
+}
 
-        if (new_has_priority) {
-            current_job->preempt_requested = 1;
+// Jobs another CPU may take: all but the one running here
+static int stealable(int cpu) {
+    const Cpu *c = &cpus[cpu];
+    return c->len - (c->current ? 1 : 0);
+}
+
+// Where a new job goes, and whether it preempts someone:
+//  - an idle CPU if there is one (least queued work first),
+//  - else the CPU whose running program the job beats (a shell command
+//    beats any program, SRJF otherwise) with the longest remaining_time,
+//    which is told to stop after its current unit,
+//  - else the CPU with the least queued work.
+static int place_job(const Job *j) {
+    int idle = -1, victim = -1, least = 0;
+    for (int i = 0; i < sched_ncpus; i++) {
+        Job *cur = cpus[i].current;
+        if (cpus[i].work < cpus[least].work) least = i;
+        if (!cur) {
+            if (idle < 0 || cpus[i].work < cpus[idle].work) idle = i;
+            continue;
         }
+        if (cur->is_shell_cmd) continue;
+        if (!j->is_shell_cmd && j->remaining_time >= cur->remaining_time) continue;
+        if (victim < 0 || cur->remaining_time > cpus[victim].current->remaining_time) victim = i;
     }
+    if (idle >= 0) return idle;
+    if (victim >= 0) {
+        cpus[victim].current->preempt_requested = 1;
+        return victim;
+    }
+    return least;
+}
 
-    // Let scheduler know something changed (new job and/or preemption)
-    pthread_cond_signal(&sched_cond);
+void add_job(Job *j) {
+    j->seq = ++next_job_seq;
+    j->heap_key = j->remaining_time;
+    j->queued_work = job_work(j);
+    queued_work_sum += j->queued_work;
+    queued_jobs++;
+    heap_push(place_job(j), j);
+
+    // Let the scheduler know something changed (new job and/or preemption)
+    pthread_cond_broadcast(&sched_cond);
+}
+
+// Decrease-key: a slice only ever lowers remaining_time, so the job can
+// only move towards the root.
+void update_job(Job *j) {
+    if (j->cpu < 0 || j->cpu >= sched_ncpus) return;
+    Cpu *c = &cpus[j->cpu];
+    int i = j->heap_idx;
+    if (i < 0 || i >= c->len || c->heap[i] != j) return;
+    queued_work_sum += job_work(j) - j->queued_work;
+    c->work += job_work(j) - j->queued_work;
+    j->queued_work = job_work(j);
+    j->heap_key = j->remaining_time;
+    sift_up(c, i);
 }
 
 void remove_job(Job *j) {
-    if (!job_queue) return;
-    if (job_queue == j) {
-        job_queue = j->next;
-        return;
+    if (!heap_remove(j)) return;
+    queued_jobs--;
+    queued_work_sum -= j->queued_work;
+}
+
+// The CPU is free again after a slice of j
+void slice_done(Job *j) {
+    Cpu *c = &cpus[j->cpu];
+    if (c->current == j) c->current = NULL;
+    if (j->status == JOB_FINISHED) remove_job(j);
+    else update_job(j);          // ran down remaining_time
+}
+
+// Work stealing: an idle CPU with an empty queue takes a job from the CPU
+// with the most jobs waiting. Returns false if there is none.
+static bool steal_job(int cpu) {
+    int victim = -1;
+    for (int i = 0; i < sched_ncpus; i++) {
+        if (i == cpu || stealable(i) <= 0) continue;
+        if (victim < 0 || stealable(i) > stealable(victim)) victim = i;
     }
-    Job *curr = job_queue;
-    while (curr->next && curr->next != j) {
-        curr = curr->next;
+    if (victim < 0) return false;
+    Cpu *v = &cpus[victim];
+
+    // Candidates: the root and its children, less the job running there.
+    // A job that has not run yet has no warm cache to leave behind, so it
+    // moves first; one that has ran stays on its CPU if it can.
+    Job *j = NULL;
+    for (int i = 0; i < 3 && i < v->len; i++) {
+        Job *c = v->heap[i];
+        if (c == v->current) continue;
+        bool fresh = c->rounds_run == 0, jfresh = j && j->rounds_run == 0;
+        if (!j || fresh > jfresh || (fresh == jfresh && job_before(c, j))) j = c;
     }
-    if (curr->next == j) {
-        curr->next = j->next;
+    heap_remove(j);
+    heap_push(cpu, j);          // keeps its seq, so no queue jumping
+    return true;
+}
+
+bool cpu_can_run(int cpu) {
+    if (cpus[cpu].current) return false;
+    if (cpus[cpu].len) return true;
+    for (int i = 0; i < sched_ncpus; i++) {
+        if (stealable(i) > 0) return true;
     }
+    return false;
 }
 
-// THE ALGORITHM: Combined SRJF + RR
-Job* get_next_job() {
-    if (!job_queue) return NULL;
+int sched_ready_cpu(void) {
+    if (!queued_jobs) return -1;
+    for (int i = 0; i < sched_ncpus; i++) {
+        if (cpu_can_run(i)) return i;
+    }
+    return -1;
+}
 
-    Job *best = NULL;
-    Job *curr = job_queue;
-    int count = 0;
+// THE ALGORITHM: Combined SRJF + RR, per CPU
+Job* get_next_job(int cpu) {
+    Cpu *c = &cpus[cpu];
+    if (!c->len && !steal_job(cpu)) return NULL;
 
-    // Check for Shell Commands (-1) - HIGHEST PRIORITY
+    // Shell commands (-1) sort first: HIGHEST PRIORITY.
     // They are non-preemptive, run immediately.
-    while (curr) {
-        if (curr->status != JOB_FINISHED && curr->is_shell_cmd) {
-            return curr;
-        }
-        count++;
-        curr = curr->next;
-    }
-
-    // Filter for SRJF (Programs)
-    curr = job_queue;
-    int min_remaining = 999999;
-
-    while (curr) {
-        if (curr->status != JOB_FINISHED) {
-            // Constraint: Same process can't be selected 2x consecutive times
-            // UNLESS it is the only process left.
-            bool skip = (count > 1 && curr->id == last_job_id);
-
-            if (!skip) {
-                if (curr->remaining_time < min_remaining) {
-                    min_remaining = curr->remaining_time;
-                    best = curr;
-                }
-            }
+    Job *best = c->heap[0];
+    if (!best->is_shell_cmd) {
+        // SRJF over programs. Constraint: same process can't be selected 2x
+        // consecutive times UNLESS it is the only process left. The
+        // runner-up of a heap is always one of the root's children.
+        if (c->len > 1 && best->seq == c->last_seq) {
+            best = c->heap[1];
+            if (c->len > 2 && job_before(c->heap[2], best)) best = c->heap[2];
         }
-        curr = curr->next;
-    }
-
-    if (best) {
-        last_job_id = best->id;
+        c->last_seq = best->seq;
     }
+    c->current = best;
     return best;
 }
 
-void append_timeline(int job_id, int duration) {
+void append_timeline(int cpu, int job_id, int duration) {
     // Ignore bogus / non-positive slices
-    if (duration <= 0) return;
+    if (duration <= 0 || cpu < 0 || cpu >= sched_ncpus) return;
 
     TimelineEntry *e = malloc(sizeof(*e));
     if (!e) return;  // ignore on OOM, not worth crashing the server
@@ -132,41 +349,52 @@ void append_timeline(int job_id, int duration) {
     e->duration = duration;
     e->next = NULL;
 
-    if (!timeline_head) {
-        timeline_head = timeline_tail = e;
+    Cpu *c = &cpus[cpu];
+    pthread_mutex_lock(&timeline_lock);
+    if (!c->tl_head) {
+        c->tl_head = c->tl_tail = e;
     } else {
-        timeline_tail->next = e;
-        timeline_tail = e;
+        c->tl_tail->next = e;
+        c->tl_tail = e;
     }
+    pthread_mutex_unlock(&timeline_lock);
 }
 
+// One line per CPU that ran something ("CPU1: 0)-P2-(3..." with more than
+// one CPU); times add up the slices of that CPU only.
 void print_timeline(void) {
-    if (!timeline_head) {
-        // No demo jobs ran -> no Gantt diagram
-        return;
-    }
+    pthread_mutex_lock(&timeline_lock);
+    for (int i = 0; i < sched_ncpus; i++) {
+        Cpu *c = &cpus[i];
+        if (!c->tl_head) {
+            // No demo jobs ran here -> no Gantt diagram
+            continue;
+        }
 
-    int current_time = 0;
-    TimelineEntry *cur = timeline_head;
+        int current_time = 0;
+        TimelineEntry *cur = c->tl_head;
 
-    // Print initial "0"
-    printf("%d", current_time);
+        // Print initial "0"
+        if (sched_ncpus > 1) printf("CPU%d: ", i);
+        printf("%d", current_time);
 
-    while (cur) {
-        current_time += cur->duration;  // cumulative time
-        printf(")-P%d-(%d", cur->job_id, current_time);
-        cur = cur->next;
-    }
+        while (cur) {
+            current_time += cur->duration;  // cumulative time
+            printf(")-P%d-(%d", cur->job_id, current_time);
+            cur = cur->next;
+        }
 
-    printf("\n");
-    fflush(stdout);
+        printf("\n");
 
-    // Clear the timeline after printing so the next run starts fresh
-    cur = timeline_head;
-    while (cur) {
-        TimelineEntry *next = cur->next;
-        free(cur);
-        cur = next;
+        // Clear the timeline after printing so the next run starts fresh
+        cur = c->tl_head;
+        while (cur) {
+            TimelineEntry *next = cur->next;
+            free(cur);
+            cur = next;
+        }
+        c->tl_head = c->tl_tail = NULL;
     }
-    timeline_head = timeline_tail = NULL;
-}
\ No newline at end of file
+    fflush(stdout);
+    pthread_mutex_unlock(&timeline_lock);
+}
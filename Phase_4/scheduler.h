@@ -1,6 +1,7 @@
 #ifndef SCHEDULER_H
 #define SCHEDULER_H
 #include <pthread.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <sys/types.h>
 #include <netinet/in.h>
@@ -17,7 +18,10 @@ typedef enum {
 // The Job Structure
 typedef struct Job {
     int id;                 // Client ID
+    unsigned long seq;      // Unique per job (a client may have several queued)
+    uint32_t req_id;        // Request tag on multiplexed connections (else 0)
     int socket_fd;          // Client socket
+    struct FrameWriter *out; // Per-connection frame writer for output
     
     char *command;          // Full command string
     bool is_shell_cmd;      // true if ls, pwd, etc. false if ./demo
@@ -31,7 +35,15 @@ typedef struct Job {
     pid_t pid;              // The child process ID
     int pipe_fd;            // Read end of the pipe
     bool started;           // Has fork() happened?
+    int core;               // --affinity: core its process is pinned to, or -1
     int rounds_run;         // How many times it has been scheduled
+
+    // Timing trailer (microseconds, CLOCK_MONOTONIC)
+    uint64_t submit_us;     // when the command was received
+    uint64_t slice_start_us; // start of the slice currently running
+    uint64_t run_us;        // CPU time held in earlier slices
+    uint64_t wall_used_ns;  // --quantum-mode=wall: wall time held in earlier slices
+    uint64_t charged_ns;    // --quantum-mode=wall|cpu: time already charged as whole units
     
     JobStatus status;
     
@@ -39,21 +51,50 @@ typedef struct Job {
     pthread_cond_t cond;    // Thread sleeps here when not running
     bool my_turn;           // Flag to wake up
     volatile sig_atomic_t preempt_requested;
-    struct Job *next;
+
+    // Run queue bookkeeping (scheduler.c, under sched_lock)
+    int cpu;                // CPU whose run queue holds it (and runs it)
+    int heap_idx;           // slot in that CPU's heap
+    int heap_key;           // remaining_time when last (re)queued
+    int queued_work;        // work counted for it in queued_work()
 } Job;
 
+// Admission control (all under sched_lock). A limit of 0 means unlimited.
+// Work is the sum of remaining_time over queued jobs (as of their last
+// slice); a shell command counts as one unit.
+typedef enum {
+    ADMIT_OK,
+    ADMIT_TOO_MANY_JOBS,
+    ADMIT_TOO_MUCH_WORK
+} AdmitResult;
+
+#define DEFAULT_BURST 10    // units assumed for a ./program with no N
+#define SCHED_UNIT_MS 1000  // default wall time of one time unit (a demo line)
+
+extern int sched_max_jobs;
+extern int sched_max_work;
+extern int sched_unit_ms;   // wall time of one unit, for retry hints
+extern int queued_jobs;     // jobs in the run queues, the running ones included
+
 // Global Scheduler State
 extern pthread_mutex_t sched_lock;
-extern pthread_cond_t sched_cond; // Wakes scheduler thread
-extern Job *job_queue;
-extern Job *current_job;
-extern bool cpu_busy;
+extern pthread_cond_t sched_cond; // Wakes scheduler thread(s)
+extern int sched_ncpus;     // virtual CPUs, each with its own run queue
 // Functions
-void scheduler_init();
-void add_job(Job *job);
+void scheduler_init(int ncpus);
+void add_job(Job *job);     // onto an idle CPU, or preempts, see place_job()
+AdmitResult admit_job(Job *job);   // add_job() unless a limit is hit
+int queued_work(void);
+unsigned admit_retry_ms(AdmitResult r, const Job *job);  // "retry after" hint
+void job_classify(Job *job, const char *cmd);  // burst / shell fields from the command
+int job_quantum(const Job *job);   // units in the job's next slice
+void update_job(Job *job);  // re-sort after a slice changed remaining_time
 void remove_job(Job *job);
-Job* get_next_job(); // The SRJF Algorithm
-void append_timeline(int job_id, int duration);
+Job* get_next_job(int cpu); // The SRJF Algorithm; cpu now runs the job
+void slice_done(Job *job);  // frees the job's CPU; removes it if finished
+bool cpu_can_run(int cpu);  // idle, with a job of its own or one to steal
+int sched_ready_cpu(void);  // some CPU for which cpu_can_run(), or -1
+void append_timeline(int cpu, int job_id, int duration);
 void print_timeline();
 
 #endif
\ No newline at end of file
@@ -1,4 +1,3 @@
-#define DEFAULT_BURST 10
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,18 +7,92 @@
 #include <stdarg.h>
 #include <sys/wait.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <time.h>
 #include <errno.h>
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <signal.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <semaphore.h>
 #include "net.h"
+#include "io.h"
+#include "frame.h"
 #include "utils.h"
 #include "scheduler.h"
+#include "server.h"
+#include "reactor.h"
+#include "pool.h"
+#include "record.h"
+#include "affinity.h"
 #include <stdbool.h>
 
+ServerConfig g_cfg = {
+    .port = 5050,
+    .mode = MODE_THREADS,
+    .reactors = 1,
+    .io = IO_BACKEND_NET,
+    .write_mode = FW_LATENCY,
+    .coalesce_bytes = 16384,
+    .coalesce_us = 2000,
+    .max_frame = FR_DEFAULT_MAX_FRAME,
+    .max_inflight = 64,
+    .compress_min = 512,
+    .accept_shards = 1,
+    .backlog = 1024,
+    .pool_min = 4,
+    .pool_max = 1024,
+    .stack_kb = 256,
+    .cpus = 1,
+    .quantum_mode = QUANTUM_LINES,
+    .unit_ms = SCHED_UNIT_MS,
+};
+
+// Threads mode: connection handlers run on this pool, and the commands of
+// multiplexed connections (each waits for its turn in the scheduler) on
+// the second one
+static WorkerPool *g_pool;
+static WorkerPool *g_job_pool;
+static sem_t g_job_slots;       // free job pool workers, see submit_mux_command()
+
 static int g_client_counter = 0;
+
+// Admission control counters, reported by the "\0STATS" control frame
+static int g_active_conns = 0;
+static unsigned long g_rejected_conns, g_rejected_jobs, g_rejected_work;
+
+int next_client_id(void) {
+    return __atomic_add_fetch(&g_client_counter, 1, __ATOMIC_RELAXED);
+}
+
+// Tells a client we won't serve it: a v1 busy line plus the "session
+// closed" marker. The caller closes the socket.
+static void send_conn_busy(int cfd) {
+    char msg[64];
+    int len = snprintf(msg, sizeof(msg), "busy, retry after %d ms\n", sched_unit_ms);
+    uint32_t hdr[2] = { htonl((uint32_t)len), 0xFFFFFFFFu };
+    struct iovec iov[3] = { { &hdr[0], 4 }, { msg, (size_t)len }, { &hdr[1], 4 } };
+    (void)writevn(cfd, iov, 3);  // best effort: the peer may not even read it
+}
+
+// Connection limit check for a freshly accepted socket
+bool conn_admit(int cfd) {
+    int n = __atomic_add_fetch(&g_active_conns, 1, __ATOMIC_RELAXED);
+    if (g_cfg.max_conns <= 0 || n <= g_cfg.max_conns) return true;
+    __atomic_sub_fetch(&g_active_conns, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&g_rejected_conns, 1, __ATOMIC_RELAXED);
+    send_conn_busy(cfd);
+    return false;
+}
+
+void conn_release(void) {
+    __atomic_sub_fetch(&g_active_conns, 1, __ATOMIC_RELAXED);
+}
+
 // Logging helpers
-static void log_line_prefixed(const char *tag, const char *prefix, const char *fmt, ...) {
+void log_line_prefixed(const char *tag, const char *prefix, const char *fmt, ...) {
     (void)tag;  // tag now unused on purpose, since phase 4 requires different output format
     va_list ap;
     va_start(ap, fmt);
@@ -35,95 +108,398 @@ static void log_line_prefixed(const char *tag, const char *prefix, const char *f
 }
 #define LOG_INFO(...) do { fprintf(stderr, "[INFO] "); fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); } while(0)
 
-// Re-implementing a simple frame receiver compatible with the client
-int recv_frame_str(int fd, char **buf) {
-    uint32_t len;
-    ssize_t r = readn(fd, &len, 4);
+#define POOL_IDLE_MS 5000  // surplus connection workers retire after this
 
-    if (r == 0) {
-        // clean EOF: client closed connection
-        *buf = NULL;
-        return 0;
+#define ZERO_COPY_PIPE_SIZE (1024 * 1024)
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+// Turns a received frame into a command string in place (no copy):
+// the view is already NUL-terminated, we only strip the trailing newline.
+char *command_from_frame(FrameView *v) {
+    if (v->len > 0 && v->data[v->len-1] == '\n') v->data[--v->len] = 0;
+    return v->data;
+}
+
+// ---------------------------------------------------------------------------
+// EXECUTION LOGIC
+// ---------------------------------------------------------------------------
+
+// Copies child output to the client in 1 KB frames
+static void stream_shell_output(Job *job, int pipe_fd) {
+    // Two buffers: while one chunk is being sent the next read fills the
+    // other, which lets the io_uring backend submit both in one syscall.
+    char buf[2][1024];
+    int cur = 0;
+    ssize_t r = io_read(pipe_fd, buf[cur], sizeof(buf[cur]));
+    while (r > 0) {
+        // send output to client and read the next chunk
+        ssize_t next = fw_send_and_read(job->out, job->req_id, buf[cur], (uint32_t)r,
+                                        pipe_fd, buf[cur ^ 1], sizeof(buf[cur ^ 1]));
+
+        // log bytes sent
+        char prefix[64];
+        snprintf(prefix, sizeof(prefix), "[%d]", job->id);
+        log_line_prefixed("SENT", prefix, "<<< %zd bytes sent", r);
+
+        cur ^= 1;
+        r = next;
+    }
+}
+
+// Zero-copy: each frame is whatever the (enlarged) pipe holds, moved to the
+// socket with splice() instead of read() + write()
+static void stream_shell_output_zero_copy(Job *job, int pipe_fd) {
+    ssize_t r;
+    while ((r = fw_splice_frame(job->out, job->req_id, FT_STDOUT, pipe_fd, ZERO_COPY_PIPE_SIZE)) > 0) {
+        char prefix[64];
+        snprintf(prefix, sizeof(prefix), "[%d]", job->id);
+        log_line_prefixed("SENT", prefix, "<<< %zd bytes sent", r);
     }
     if (r < 0) {
-        // error on socket
-        return -1;
+        // Client is gone (or splice is unsupported for this socket): keep
+        // draining so the child never blocks on a full pipe.
+        char buf[4096];
+        while (read(pipe_fd, buf, sizeof(buf)) > 0) {}
     }
+}
 
-    len = ntohl(len);
-    if (len == 0) { *buf = strdup(""); return 0; }
-
-    *buf = malloc(len + 1);
-    if (!*buf) return -1;
+// V2 connections: stdout and stderr come through separate pipes and go out
+// as FT_STDOUT / FT_STDERR frames, in whatever order the child writes them.
+static void stream_shell_output_split(Job *job, int out_fd, int err_fd) {
+    struct pollfd p[2] = { { .fd = out_fd, .events = POLLIN }, { .fd = err_fd, .events = POLLIN } };
+    const uint8_t types[2] = { FT_STDOUT, FT_STDERR };
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "[%d]", job->id);
+    bool broken = false;
+    // Compressed connections copy in bigger chunks (better ratio) and never
+    // splice: the payload has to pass through the compressor anyway.
+    bool splice_ok = g_cfg.zero_copy && !job->out->compress;
+    size_t cap = job->out->compress ? 64 * 1024 : 1024;
+    char *buf = malloc(cap);
+    if (!buf) return;
 
-    r = readn(fd, *buf, len);
-    if (r <= 0) {  // short read / error
-        free(*buf);
-        *buf = NULL;
-        return -1;
+    while (p[0].fd >= 0 || p[1].fd >= 0) {
+        if (poll(p, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < 2; i++) {
+            if (p[i].fd < 0 || !p[i].revents) continue;
+            ssize_t r;
+            if (splice_ok && !broken) {
+                r = fw_splice_frame(job->out, job->req_id, types[i], p[i].fd, ZERO_COPY_PIPE_SIZE);
+            } else {
+                r = io_read(p[i].fd, buf, cap);
+                if (r > 0 && !broken && fw_send_typed(job->out, job->req_id, types[i], buf, (uint32_t)r) < 0) {
+                    broken = true;
+                }
+            }
+            if (r < 0 && splice_ok && !broken) { broken = true; continue; }  // drain by copying
+            if (r <= 0) { p[i].fd = -1; continue; }
+            if (!broken) log_line_prefixed("SENT", prefix, "<<< %zd bytes sent", r);
+        }
     }
+    free(buf);
+}
 
-    (*buf)[len] = 0;
-    // Strip newline
-    if (len > 0 && (*buf)[len-1] == '\n') (*buf)[len-1] = 0;
-    return 0;
+// Exit status, timing trailer and end-of-command marker. V1 clients only
+// see the (empty) end frame.
+static void send_job_trailer(Job *job, int exit_code) {
+    uint64_t now = now_us();
+    FrameTiming t;
+    t.run_us = job->run_us + (now - job->slice_start_us);
+    t.turnaround_us = now - job->submit_us;
+    t.queue_wait_us = t.turnaround_us - t.run_us;
+    char timing[FRAME_TIMING_SIZE];
+    frame_encode_timing(&t, timing);
+    char code[4];
+    wire_put_u32(code, (uint32_t)exit_code);
+
+    // Logged before END goes out, so it precedes the client's next command
+    RecDone d = { exit_code, 0, t.queue_wait_us, t.run_us, t.turnaround_us };
+    record_event(REC_DONE, job->id, job->req_id, FT_EXIT, &d, sizeof(d));
+
+    fw_send_typed(job->out, job->req_id, FT_EXIT, code, sizeof(code));
+    fw_send_typed(job->out, job->req_id, FT_TIMING, timing, sizeof(timing));
+    fw_send_typed(job->out, job->req_id, FT_END, NULL, 0);
+    fw_flush(job->out);
 }
 
-static int send_frame(int fd, const char *buf, uint32_t len) {
-    uint32_t be = htonl(len);
-    if (writen(fd, &be, 4) != 4) return -1;
-    if (len && writen(fd, buf, len) != (ssize_t)len) return -1;
-    return 0;
+// First thing in every job child: its worker core, and the default signal
+// mask (--record blocks SIGINT/SIGTERM in the server, and a blocked mask
+// survives execvp).
+static void job_child_init(Job *job) {
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL);
+    affinity_pin_pid(0, affinity_core(job->cpu));
 }
 
-// ---------------------------------------------------------------------------
-// EXECUTION LOGIC
-// ---------------------------------------------------------------------------
+// Local mode: the child writes straight into the client's stdout/stderr,
+// only the trailer goes back over the socket.
+static void execute_shell_job_direct(Job *job) {
+    job->pid = fork();
+    if (job->pid == 0) {
+        job_child_init(job);
+        dup2(job->out->out_fds[0], STDOUT_FILENO);
+        dup2(job->out->out_fds[1], STDERR_FILENO);
+
+        char **tokens = parse_command(job->command);
+        Stage *stages; int n; const char *err;
+        if (build_pipeline(tokens, &stages, &n, &err) < 0) {
+            fprintf(stderr, "%s\n", err);
+            exit(2);
+        }
+        int rc = exec_pipeline(stages, n, -1);
+        exit(rc < 0 ? 1 : rc);
+    }
+    int status = 0;
+    if (job->pid > 0) waitpid(job->pid, &status, 0);
+    else status = 1 << 8;  // fork failed: report exit code 1
+    send_job_trailer(job, exit_code_from_status(status));
+    job->status = JOB_FINISHED;
+}
+
+// One line of demo output: a frame, or a direct write in local mode
+static int job_emit_output(Job *job, const char *buf, size_t len) {
+    if (job->out->out_fds[0] >= 0) return writen(job->out->out_fds[0], buf, len) < 0 ? -1 : 0;
+    return fw_send_tagged(job->out, job->req_id, buf, (uint32_t)len);
+}
 
 // Runs a shell command (non-preemptive, burst -1)
 // Reuses logic from Phase 3 but wrapped for the Job system
 void execute_shell_job(Job *job) {
-    int out_pfd[2];
+    if (job->out->out_fds[0] >= 0) { execute_shell_job_direct(job); return; }
+    bool split = job->out->fmt == FRAME_V2;  // only v2 can tell stderr apart
+    int out_pfd[2], err_pfd[2] = { -1, -1 };
     if (pipe(out_pfd) < 0) return;
+    if (split && pipe(err_pfd) < 0) { close(out_pfd[0]); close(out_pfd[1]); return; }
+    if (g_cfg.zero_copy) {
+        // Bigger pipe = bigger spliced frames (silently capped by pipe-max-size)
+        fcntl(out_pfd[0], F_SETPIPE_SZ, ZERO_COPY_PIPE_SIZE);
+    }
 
     job->pid = fork();
     if (job->pid == 0) {
-        // Child
+        // Child (and the whole pipeline) on the job's worker core
+        job_child_init(job);
         close(out_pfd[0]);
         dup2(out_pfd[1], STDOUT_FILENO);
-        dup2(out_pfd[1], STDERR_FILENO);
+        if (split) {
+            close(err_pfd[0]);
+            dup2(err_pfd[1], STDERR_FILENO);
+            close(err_pfd[1]);
+        } else {
+            dup2(out_pfd[1], STDERR_FILENO);
+        }
         close(out_pfd[1]);
 
         char **tokens = parse_command(job->command);
         Stage *stages; int n; const char *err;
         if (build_pipeline(tokens, &stages, &n, &err) < 0) {
             fprintf(stderr, "%s\n", err);
-            exit(1);
+            exit(2);  // bash uses 2 for syntax errors
         }
-        exec_pipeline(stages, n, -1);
-        exit(0);
+        int rc = exec_pipeline(stages, n, -1);
+        exit(rc < 0 ? 1 : rc);
     }
 
     // Parent
     close(out_pfd[1]);
-    char buf[1024];
-    ssize_t r;
-    while ((r = read(out_pfd[0], buf, sizeof(buf))) > 0) {
-        // send output to client
-        send_frame(job->socket_fd, buf, (uint32_t)r);
-
-        // log bytes sent
-        char prefix[64];
-        snprintf(prefix, sizeof(prefix), "[%d]", job->id);
-        log_line_prefixed("SENT", prefix, "<<< %zd bytes sent", r);
+    if (split) {
+        close(err_pfd[1]);
+        stream_shell_output_split(job, out_pfd[0], err_pfd[0]);
+        close(err_pfd[0]);
+    } else if (g_cfg.zero_copy) {
+        stream_shell_output_zero_copy(job, out_pfd[0]);
+    } else {
+        stream_shell_output(job, out_pfd[0]);
     }
-    
-    // Important: Send empty frame to signal "End of Command"
-    send_frame(job->socket_fd, NULL, 0);
-
     close(out_pfd[0]);
+
+    int status = 0;
+    waitpid(job->pid, &status, 0);
+
+    // Important: the (empty) END frame signals "End of Command"
+    send_job_trailer(job, exit_code_from_status(status));
+    job->status = JOB_FINISHED;
+}
+
+// The client went away mid-slice: kill the child and end the job
+static void abandon_demo_job(Job *job) {
+    kill(job->pid, SIGKILL);
     waitpid(job->pid, NULL, 0);
     job->status = JOB_FINISHED;
+    job->remaining_time = 0;
+
+    // Let the connection owner notice the dead peer and close the fd
+    // itself; closing it here would race with its next read.
+    shutdown(job->socket_fd, SHUT_RDWR);
+}
+
+// --quantum-mode=lines: one output line is one time unit. Returns the units
+// used (also the slice's length on the timeline, *span), or -1 if the client
+// disconnected.
+static int run_line_slice(Job *job, int quantum, int *span) {
+    int time_consumed = 0;
+    FILE *fp = fdopen(job->pipe_fd, "r");
+    char *line = NULL; size_t len = 0;
+
+    while (time_consumed < quantum && job->remaining_time > 0) {
+
+        // *** PREEMPTION CHECK ***
+        if (job->preempt_requested) {
+            // Someone with higher priority arrived; stop after this unit
+            break;
+        }
+
+        // Don't let coalesced lines sit in the writer while the child is quiet
+        fw_wait_readable(job->out, job->pipe_fd);
+        ssize_t read = getline(&line, &len, fp);
+        if (read == -1) {
+            job->remaining_time = 0; // EOF
+            break;
+        }
+
+        int rc = job_emit_output(job, line, (size_t)read);
+        if (rc < 0) {
+            // client disconnected -> kill child, mark job finished, stop running this job
+            free(line);
+            abandon_demo_job(job);
+            return -1;
+        }
+
+        job->remaining_time--;
+        time_consumed++;
+    }
+    free(line);
+    *span = time_consumed;
+    return time_consumed;
+}
+
+// CPU time the child has used so far: its CPU-time clock, or utime + stime
+// from /proc/<pid>/stat where that clock is not available
+static uint64_t child_cpu_ns(pid_t pid) {
+    clockid_t clk;
+    struct timespec ts;
+    if (clock_getcpuclockid(pid, &clk) == 0 && clock_gettime(clk, &ts) == 0) {
+        return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+    }
+    char path[64], buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return 0;
+    buf[n] = '\0';
+    // Fields 14 and 15, counted after the ")" that closes the command name
+    char *p = strrchr(buf, ')');
+    unsigned long long utime, stime;
+    if (!p || sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+                     &utime, &stime) != 2) {
+        return 0;
+    }
+    return (utime + stime) * (1000000000u / (uint64_t)sysconf(_SC_CLK_TCK));
+}
+
+// Time the job has used in --quantum-mode=wall|cpu: wall time across its
+// slices (this one started at slice_t0_ns), or the child's CPU time
+static uint64_t job_used_ns(Job *job, bool cpu, uint64_t slice_t0_ns) {
+    return cpu ? child_cpu_ns(job->pid) : job->wall_used_ns + (now_us() * 1000 - slice_t0_ns);
+}
+
+// Whole units of used time not charged yet; the part of a unit left over
+// stays in charged_ns's remainder and counts towards the next charge.
+static int charge_units(Job *job, uint64_t used_ns, uint64_t unit_ns) {
+    if (used_ns <= job->charged_ns) return 0;
+    int units = (int)((used_ns - job->charged_ns) / unit_ns);
+    job->charged_ns += units * unit_ns;
+    return units;
+}
+
+// --quantum-mode=wall|cpu: a timerfd ticks once per unit, whatever the
+// child prints (or doesn't). remaining_time is charged with the job's wall
+// time, or with the child's CPU time in cpu mode (a sleeping job then costs
+// nothing, but still gives the CPU up after `quantum` wall units). Time is
+// charged in whole units at each tick and when the slice ends, so a slice
+// cut short by preemption or EOF pays its fraction of a unit later. The
+// slice stops at the tick that uses up its quantum, on preemption, or at EOF.
+// While the child runs its burst cannot run out: it stays at 1 unit.
+// Returns the units charged, or -1 if the client disconnected. *span is the
+// slice's wall time in units for the timeline: rounded, but at least 1 even
+// when nothing was charged.
+static int run_timed_slice(Job *job, int quantum, int *span) {
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (tfd < 0) return run_line_slice(job, quantum, span);
+    struct itimerspec its;
+    its.it_interval.tv_sec = g_cfg.unit_ms / 1000;
+    its.it_interval.tv_nsec = (g_cfg.unit_ms % 1000) * 1000000L;
+    its.it_value = its.it_interval;
+    timerfd_settime(tfd, 0, &its, NULL);
+
+    uint64_t unit_ns = (uint64_t)g_cfg.unit_ms * 1000000u;
+    uint64_t t0 = now_us() * 1000;
+    bool cpu = g_cfg.quantum_mode == QUANTUM_CPU;
+    bool eof = false;
+    int charged = 0, ticks = 0;
+    char buf[4096];
+    struct pollfd p[2] = { { .fd = job->pipe_fd, .events = POLLIN },
+                           { .fd = tfd, .events = POLLIN } };
+
+    while (!job->preempt_requested) {
+        // The child is quiet: send what is coalesced before blocking
+        if (poll(p, 2, 0) == 0) fw_flush(job->out);
+        if (poll(p, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (p[0].revents) {
+            ssize_t n = read(job->pipe_fd, buf, sizeof(buf));
+            if (n <= 0) {
+                eof = true;
+                break;
+            }
+            if (job_emit_output(job, buf, (size_t)n) < 0) {
+                close(tfd);
+                abandon_demo_job(job);
+                return -1;
+            }
+        }
+
+        if (p[1].revents) {
+            uint64_t expired = 0;
+            if (read(tfd, &expired, sizeof(expired)) != sizeof(expired)) continue;
+            ticks += (int)expired;
+            int units = charge_units(job, job_used_ns(job, cpu, t0), unit_ns);
+            charged += units;
+            job->remaining_time -= units;
+            if (job->remaining_time < 1) job->remaining_time = 1;
+            if (ticks >= quantum || charged >= quantum) break;
+        }
+    }
+    close(tfd);
+
+    // Charge what accrued since the last tick
+    int units = charge_units(job, job_used_ns(job, cpu, t0), unit_ns);
+    charged += units;
+    if (eof) {
+        job->remaining_time = 0;
+    } else {
+        job->remaining_time -= units;
+        if (job->remaining_time < 1) job->remaining_time = 1;
+    }
+    uint64_t wall_ns = now_us() * 1000 - t0;
+    job->wall_used_ns += wall_ns;
+    *span = (int)((wall_ns + unit_ns / 2) / unit_ns);
+    if (*span < 1) *span = 1;
+    return charged;
 }
 
 // Runs a demo job (preemptive, creates child, manages SIGSTOP/SIGCONT)
@@ -135,6 +511,7 @@ void execute_demo_job(Job *job, int quantum) {
         
         job->pid = fork();
         if (job->pid == 0) {
+            job_child_init(job);
             close(pfd[0]);
             // Force line buffering for pipe
             setvbuf(stdout, NULL, _IOLBF, 0); 
@@ -149,51 +526,31 @@ void execute_demo_job(Job *job, int quantum) {
         close(pfd[1]);
         job->pipe_fd = pfd[0];
         job->started = true;
+        job->core = affinity_core(job->cpu);
+        job->charged_ns = 0;
+        job->wall_used_ns = 0;
         
         char prefix[64]; snprintf(prefix, 64, "(%d)", job->id);
         log_line_prefixed("INFO", prefix, "--- created (%d)", job->total_time);
         log_line_prefixed("INFO", prefix, "--- started (%d)", job->remaining_time);
     } else {
-        // Resume
+        // Resume, following the job if another CPU took it over
+        int core = affinity_core(job->cpu);
+        if (core != job->core) {
+            affinity_pin_pid(job->pid, core);
+            job->core = core;
+        }
         kill(job->pid, SIGCONT);
         char prefix[64]; snprintf(prefix, 64, "(%d)", job->id);
         log_line_prefixed("INFO", prefix, "--- running (%d)", job->remaining_time);
     }
 
-    int time_consumed = 0;
-    FILE *fp = fdopen(job->pipe_fd, "r");
-    char *line = NULL; size_t len = 0;
-
-    while (time_consumed < quantum && job->remaining_time > 0) {
-
-        // *** PREEMPTION CHECK ***
-        if (job->preempt_requested) {
-            // Someone with higher priority arrived; stop after this unit
-            break;
-        }
-
-        ssize_t read = getline(&line, &len, fp);
-        if (read == -1) {
-            job->remaining_time = 0; // EOF
-            break;
-        }
-
-        int rc = send_frame(job->socket_fd, line, (uint32_t)read);
-        if (rc < 0) {
-            // client disconnected -> kill child, mark job finished, stop running this job
-            kill(job->pid, SIGKILL);
-            waitpid(job->pid, NULL, 0);
-            job->status = JOB_FINISHED;
-            job->remaining_time = 0;
-
-            close(job->socket_fd);
-            return; // exit execute_demo_job early
-        }
-
-        job->remaining_time--;
-        time_consumed++;
-    }
-    free(line);
+    int span;  // slice length on the timeline
+    int time_consumed = g_cfg.quantum_mode == QUANTUM_LINES ? run_line_slice(job, quantum, &span)
+                                                            : run_timed_slice(job, quantum, &span);
+    if (time_consumed < 0) return;  // client gone, job already ended
+    // End of slice: whatever was coalesced goes out before we give up the CPU
+    fw_flush(job->out);
 
     // Log chunk sent
     if (time_consumed > 0) {
@@ -211,18 +568,19 @@ void execute_demo_job(Job *job, int quantum) {
         char prefix[64]; snprintf(prefix, 64, "(%d)", job->id);
         log_line_prefixed("INFO", prefix, "--- waiting (%d)", job->remaining_time);
 
-        append_timeline(job->id, time_consumed);
+        append_timeline(job->cpu, job->id, span);
     } else {
         // Job finished
-        waitpid(job->pid, NULL, 0);
+        int status = 0;
+        waitpid(job->pid, &status, 0);
         job->status = JOB_FINISHED;
 
         // If client already died, this will just fail and we ignore it
-        (void)send_frame(job->socket_fd, NULL, 0);
+        send_job_trailer(job, exit_code_from_status(status));
 
         char prefix[64]; snprintf(prefix, 64, "(%d)", job->id);
         log_line_prefixed("INFO", prefix, "--- ended (%d)", 0);
-        append_timeline(job->id, time_consumed);
+        append_timeline(job->cpu, job->id, span);
     }
 }
 
@@ -235,17 +593,15 @@ void *scheduler_thread_func(void *arg) {
     while (1) {
         pthread_mutex_lock(&sched_lock);
 
-        // Wait until:
-        //  - there is at least one job, AND
-        //  - the CPU is not currently being used by some job
-        while ((!job_queue) || cpu_busy) {
+        // Wait until some CPU is free and has a job to run (its own or
+        // one it can steal)
+        int cpu;
+        while ((cpu = sched_ready_cpu()) < 0) {
             pthread_cond_wait(&sched_cond, &sched_lock);
         }
 
-        Job *job = get_next_job();
+        Job *job = get_next_job(cpu);  // cpu is now occupied by this job
         if (job) {
-            cpu_busy = true;    // CPU is now occupied by this job
-            current_job = job;  // <--- remember who owns the CPU
             job->my_turn = true;
             pthread_cond_signal(&job->cond);
         }
@@ -254,175 +610,671 @@ void *scheduler_thread_func(void *arg) {
     return NULL;
 }
 
+// Fills in a Job for one received command. `cmd` must outlive the job.
+void job_setup(Job *j, int client_id, int fd, FrameWriter *out, char *cmd) {
+    memset(j, 0, sizeof(*j));
+    j->preempt_requested = 0;
+    j->id = client_id;
+    j->socket_fd = fd;
+    j->out = out;
+    j->command = cmd;
+    j->started = false;
+    j->rounds_run = 0;
+    j->status = JOB_WAITING;
+    pthread_cond_init(&j->cond, NULL);
+    j->my_turn = false;
+    j->core = -1;
+    j->submit_us = now_us();
+
+    job_classify(j, cmd);
+}
+
+// Runs one slice of a job that the scheduler just handed the CPU to.
+// Called without sched_lock; the caller releases the CPU afterwards.
+void run_job_slice(Job *j) {
+    char prefix[64]; snprintf(prefix, 64, "[%d]", j->id);
+    j->slice_start_us = now_us();
+
+    if (j->is_shell_cmd) {
+        log_line_prefixed("INFO", prefix, "--- started (-1)");
+        // Execute fully
+        execute_shell_job(j);
+        log_line_prefixed("INFO", prefix, "--- ended (-1)");
+        // IMPORTANT: shell commands are NOT part of the Gantt diagram
+        // so we do NOT call append_timeline() here.
+    } else {
+        // Program Execution
+        int quantum = job_quantum(j);
+        j->rounds_run++;
+        execute_demo_job(j, quantum);
+    }
+    j->run_us += now_us() - j->slice_start_us;
+}
+
+// Answers a command that admit_job() turned away: BUSY + END on v2,
+// a text line + the empty end frame otherwise.
+void reject_job(Job *j, AdmitResult r, unsigned retry_ms) {
+    char prefix[64]; snprintf(prefix, 64, "[%d]", j->id);
+    __atomic_add_fetch(r == ADMIT_TOO_MANY_JOBS ? &g_rejected_jobs : &g_rejected_work,
+                       1, __ATOMIC_RELAXED);
+    log_line_prefixed("INFO", prefix, "--- rejected (%s, retry after %u ms)",
+                      r == ADMIT_TOO_MANY_JOBS ? "jobs" : "work", retry_ms);
+
+    record_event(REC_BUSY, j->id, j->req_id, FT_BUSY, NULL, 0);
+
+    if (j->out->fmt == FRAME_V2) {
+        char be[4];
+        wire_put_u32(be, retry_ms);
+        fw_send_typed(j->out, j->req_id, FT_BUSY, be, sizeof(be));
+    } else {
+        char msg[64];
+        int n = snprintf(msg, sizeof(msg), "busy, retry after %u ms\n", retry_ms);
+        fw_send_tagged(j->out, j->req_id, msg, (uint32_t)n);
+    }
+    fw_send_typed(j->out, j->req_id, FT_END, NULL, 0);
+    fw_flush(j->out);
+    pthread_cond_destroy(&j->cond);
+}
+
+// Submits a job and blocks until it has finished, running each slice the
+// scheduler hands it on the calling thread.
+void run_job_blocking(Job *j) {
+    char prefix[64]; snprintf(prefix, 64, "[%d]", j->id);
+
+    // Submit to Scheduler (or turn it away right here when overloaded)
+    pthread_mutex_lock(&sched_lock);
+    AdmitResult r = admit_job(j);
+    if (r != ADMIT_OK) {
+        unsigned retry = admit_retry_ms(r, j);
+        pthread_mutex_unlock(&sched_lock);
+        reject_job(j, r, retry);
+        return;
+    }
+    
+    // If it's a shell cmd (burst -1), log creation immediately
+    if (j->is_shell_cmd) {
+         log_line_prefixed("INFO", prefix, "--- created (-1)");
+         // Note: It will start when scheduler picks it
+    }
+
+    pthread_cond_broadcast(&sched_cond); // Notify scheduler
+    
+    // Wait for Execution
+    while (j->status != JOB_FINISHED) {
+        // Wait for turn
+        while (!j->my_turn) {
+            pthread_cond_wait(&j->cond, &sched_lock);
+        }
+        // "I have the lock and it's my turn"
+        // Drop the global scheduler lock while running this slice,
+        // so other clients can enqueue jobs and the scheduler can see them.
+        pthread_mutex_unlock(&sched_lock);
+        run_job_slice(j);
+        pthread_mutex_lock(&sched_lock);
+        
+        j->my_turn = false; // Yield back to scheduler
+        slice_done(j);      // CPU is now free for someone else
+        pthread_cond_broadcast(&sched_cond);  // wake scheduler to pick next job
+    }
+    
+    bool empty = (queued_jobs == 0);
+    pthread_mutex_unlock(&sched_lock);
+    
+    pthread_cond_destroy(&j->cond);
+    
+    // If queue empty, print timeline
+    if (empty) {
+         print_timeline();
+    }
+}
+
+// "\0FDS" arrives on a unix socket with the client's stdout and stderr
+// attached (SCM_RIGHTS): from now on this connection's jobs write to them
+// directly. No reply: the client handles output frames either way.
+static void attach_client_fds(FrameReader *fr, FrameWriter *fw, const char *prefix) {
+    int out = fr_take_fd(fr);
+    if (out < 0) {
+        log_line_prefixed("ERROR", prefix, "FDS without descriptors");
+        return;
+    }
+    int err = fr_take_fd(fr);
+    if (err < 0) err = fcntl(out, F_DUPFD_CLOEXEC, 0);
+
+    pthread_mutex_lock(&fw->lock);
+    for (int i = 0; i < 2; i++) {
+        if (fw->out_fds[i] >= 0) close(fw->out_fds[i]);
+    }
+    fw->out_fds[0] = out;
+    fw->out_fds[1] = err;
+    pthread_mutex_unlock(&fw->lock);
+    log_line_prefixed("INFO", prefix, "--- local output");
+}
+
+// "\0STATS": load and admission counters as one line of output + END
+static void send_stats(FrameWriter *fw, uint32_t req_id) {
+    pthread_mutex_lock(&sched_lock);
+    int jobs = queued_jobs, work = queued_work();
+    pthread_mutex_unlock(&sched_lock);
+
+    char buf[512];
+    int n = snprintf(buf, sizeof(buf),
+                     "connections=%d queued_jobs=%d queued_work=%d "
+                     "rejected_conns=%lu rejected_jobs=%lu rejected_work=%lu\n",
+                     __atomic_load_n(&g_active_conns, __ATOMIC_RELAXED), jobs, work,
+                     __atomic_load_n(&g_rejected_conns, __ATOMIC_RELAXED),
+                     __atomic_load_n(&g_rejected_jobs, __ATOMIC_RELAXED),
+                     __atomic_load_n(&g_rejected_work, __ATOMIC_RELAXED));
+    if (g_pool) {
+        PoolStats ps;
+        pool_stats(g_pool, &ps);
+        n += snprintf(buf + n, sizeof(buf) - n,
+                      "pool_threads=%d pool_peak=%d threads_created=%lu "
+                      "threads_avoided=%lu\n",
+                      ps.threads, ps.peak_threads, ps.threads_created,
+                      ps.tasks > ps.threads_created ? ps.tasks - ps.threads_created : 0);
+    }
+    if (g_job_pool) {
+        PoolStats ps;
+        pool_stats(g_job_pool, &ps);
+        n += snprintf(buf + n, sizeof(buf) - n,
+                      "job_pool_threads=%d job_pool_peak=%d job_threads_created=%lu "
+                      "job_threads_avoided=%lu\n",
+                      ps.threads, ps.peak_threads, ps.threads_created,
+                      ps.tasks > ps.threads_created ? ps.tasks - ps.threads_created : 0);
+    }
+    fw_send_tagged(fw, req_id, buf, (uint32_t)n);
+    fw_send_typed(fw, req_id, FT_END, NULL, 0);
+    fw_flush(fw);
+}
+
+// Handles a control frame (payload starts with NUL): "HELLO", "FDS" or "STATS".
+// HELLO replies with what we accept and switches the connection's framing
+// (v2 -> FRAME_V2, v1 + "mux" -> FRAME_TAGGED, plain v1 stays as is).
+void handle_control_frame(FrameView *v, FrameReader *fr, FrameWriter *fw, const char *prefix) {
+    char *msg = v->data + 1;
+    if (strcmp(msg, "FDS") == 0) {
+        attach_client_fds(fr, fw, prefix);
+        return;
+    }
+    if (strcmp(msg, "STATS") == 0) {
+        send_stats(fw, v->req_id);
+        return;
+    }
+
+    int version = 0;
+    char features[128] = "";
+    if (sscanf(msg, "HELLO %d %127[^\n]", &version, features) < 1) {
+        log_line_prefixed("ERROR", prefix, "unknown control frame");
+        fw_send(fw, "\0ERR", 4);
+        fw_flush(fw);
+        return;
+    }
+    if (version > PROTO_VERSION) version = PROTO_VERSION;
+
+    bool mux = false, lz = false;
+    char *save = NULL;
+    for (char *tok = strtok_r(features, " ", &save); tok; tok = strtok_r(NULL, " ", &save)) {
+        if (strcmp(tok, "mux") == 0) mux = true;
+        if (strcmp(tok, "lz") == 0) lz = true;
+    }
+    lz = lz && version >= 2 && fw_compress_min() > 0;  // needs the v2 flags byte
+
+    char reply[64];
+    int n = snprintf(reply, sizeof(reply), "%cHELLO %d%s%s", 0, version,
+                     mux ? " mux" : "", lz ? " lz" : "");
+    fw_send(fw, reply, (uint32_t)n);   // answer in the old format...
+    fw_flush(fw);
+    FrameFormat fmt = version >= 2 ? FRAME_V2 : mux ? FRAME_TAGGED : FRAME_V1;
+    fw->fmt = fmt;                     // ...then switch
+    fr->fmt = fmt;
+    fw->compress = lz;
+    log_line_prefixed("INFO", prefix, "--- protocol v%d%s%s", version,
+                      mux ? " mux" : "", lz ? " lz" : "");
+}
+
+// Connection state shared with the per-command threads of a mux connection
+typedef struct {
+    int client_id;
+    int fd;
+    FrameWriter fw;
+    pthread_mutex_t lock;
+    pthread_cond_t idle;    // signalled when inflight drops
+    int inflight;           // commands submitted but not finished
+} ThreadConn;
+
+typedef struct {
+    Job job;
+    ThreadConn *conn;
+    char *cmd;              // owned copy: the reader's buffer moves on
+} MuxJob;
+
+// One job pool worker per in-flight command of a mux connection, so several
+// of its commands can wait in the scheduler queue at once.
+static void mux_job_func(void *arg) {
+    MuxJob *mj = arg;
+    ThreadConn *tc = mj->conn;
+    run_job_blocking(&mj->job);
+    free(mj->cmd);
+    free(mj);
+
+    pthread_mutex_lock(&tc->lock);
+    tc->inflight--;
+    pthread_cond_broadcast(&tc->idle);
+    pthread_mutex_unlock(&tc->lock);
+}
+
+// Job pool hook: the finished job's worker is free again
+static void job_slot_free(void *arg) {
+    sem_post(arg);
+}
+
+static void submit_mux_command(ThreadConn *tc, FrameView *v, char *cmd) {
+    pthread_mutex_lock(&tc->lock);
+    while (tc->inflight >= g_cfg.max_inflight) {
+        // Window full: stop reading until something finishes (backpressure)
+        pthread_cond_wait(&tc->idle, &tc->lock);
+    }
+    tc->inflight++;
+    pthread_mutex_unlock(&tc->lock);
+    // Every job worker busy: stop reading until one is free, as above
+    while (sem_wait(&g_job_slots) < 0 && errno == EINTR) {}
+
+    MuxJob *mj = malloc(sizeof(*mj));
+    char *copy = strdup(cmd);
+    if (mj && copy) {
+        mj->conn = tc;
+        mj->cmd = copy;
+        job_setup(&mj->job, tc->client_id, tc->fd, &tc->fw, copy);
+        mj->job.req_id = v->req_id;
+        // Slots are given back only after the pool stopped counting the
+        // job (job_slot_free), so holding one means the pool has room
+        if (pool_submit(g_job_pool, mux_job_func, mj) == 0) return;
+    }
+    free(mj);
+    free(copy);
+    sem_post(&g_job_slots);
+    fw_send_tagged(&tc->fw, v->req_id, NULL, 0);  // could not run it: just end it
+    fw_flush(&tc->fw);
+    pthread_mutex_lock(&tc->lock);
+    tc->inflight--;
+    pthread_mutex_unlock(&tc->lock);
+}
+
 // Handles ONE client connection
-void *client_thread_func(void *arg) {
-    pthread_detach(pthread_self());
+static void client_conn_func(void *arg) {
     int cfd = (int)(intptr_t)arg;
-    int client_id = ++g_client_counter;
+    ThreadConn tc;
+    tc.client_id = next_client_id();
+    tc.fd = cfd;
+    tc.inflight = 0;
+    pthread_mutex_init(&tc.lock, NULL);
+    pthread_cond_init(&tc.idle, NULL);
+    fw_init(&tc.fw, cfd);
+    FrameReader fr;
+    fr_init(&fr, cfd, g_cfg.max_frame);
     
-    char prefix[64]; snprintf(prefix, 64, "[%d]", client_id);
+    char prefix[64]; snprintf(prefix, 64, "[%d]", tc.client_id);
     log_line_prefixed("INFO", prefix, "<<< client connected");
+    record_event(REC_OPEN, tc.client_id, 0, 0, NULL, 0);
 
     // Client Loop
     while (1) {
         // Receive Command
-        char *cmd = NULL; 
-        int rf = recv_frame_str(cfd, &cmd);
+        // (cmd points into the frame reader's buffer, valid until the next read)
+        FrameView v;
+        int rf = fr_read_frame(&fr, &v);
 
         if (rf == -1) {
             // Real error
             log_line_prefixed("ERROR", prefix, "recv_frame_str failed: %s", strerror(errno));
-            free(cmd);  // safe even if cmd == NULL
             break;      // will close(cfd) and exit thread
         }
         
-        if (cmd == NULL) {
+        if (rf == 0) {
             // Clean disconnect (EOF)
             log_line_prefixed("INFO", prefix, "client disconnected");
             break;
         }
+        record_event(REC_FRAME, tc.client_id, v.req_id, v.type, v.data, v.len);
+
+        if (v.len > 0 && v.data[0] == '\0') {
+            handle_control_frame(&v, &fr, &tc.fw, prefix);
+            continue;
+        }
+        char *cmd = command_from_frame(&v);
         
         // Log reception
         log_line_prefixed("RECEIVED", prefix, ">>> %s", cmd);
 
         if (strcmp(cmd, "exit") == 0) {
-            free(cmd);
             break;
         }
 
-        // Create Job
+        if (fr.fmt != FRAME_V1) {
+            // Multiplexed: don't wait, keep reading the next command
+            submit_mux_command(&tc, &v, cmd);
+            continue;
+        }
+
+        // Create Job and wait for it
         Job j;
-        memset(&j, 0, sizeof(j));
-        j.preempt_requested = 0;
-        j.id = client_id;
-        j.socket_fd = cfd;
-        j.command = cmd;
-        j.started = false;
-        j.rounds_run = 0;
-        j.status = JOB_WAITING;
-        pthread_cond_init(&j.cond, NULL);
-        j.my_turn = false;
-
-        // Parse command type
-        if (strncmp(cmd, "./demo", 6) == 0 || strncmp(cmd, "demo", 4) == 0) {
-            // Known demo program: use N if provided, otherwise default
-            j.is_shell_cmd = false;
-
-            char *p = strchr(cmd, ' ');
-            if (p) j.total_time = atoi(p + 1);
-            else   j.total_time = DEFAULT_BURST;
-
-            j.remaining_time   = j.total_time;
-            j.burst_prediction = j.total_time;
-
-        } else if (strncmp(cmd, "./", 2) == 0) {
-            // Any other ./program (e.g., ./hello) => unknown burst -> default
-            j.is_shell_cmd     = false;
-            j.total_time       = DEFAULT_BURST;
-            j.remaining_time   = j.total_time;
-            j.burst_prediction = j.total_time;
+        job_setup(&j, tc.client_id, cfd, &tc.fw, cmd);
+        run_job_blocking(&j);
+    }
 
-        } else {
-            // Plain shell / pipeline commands (pwd, ls, cat foo | grep bar, ... )
-            j.is_shell_cmd     = true;
-            j.total_time       = -1;
-            j.remaining_time   = -1;
-            j.burst_prediction = -1;  // "infinite priority" for scheduling
-        }
+    // Jobs still running write to this socket; wait for them before closing
+    pthread_mutex_lock(&tc.lock);
+    while (tc.inflight > 0) pthread_cond_wait(&tc.idle, &tc.lock);
+    pthread_mutex_unlock(&tc.lock);
 
-        // Submit to Scheduler
-        pthread_mutex_lock(&sched_lock);
-        add_job(&j);
-        
-        // If it's a shell cmd (burst -1), log creation immediately
-        if (j.is_shell_cmd) {
-             log_line_prefixed("INFO", prefix, "--- created (-1)");
-             // Note: It will start when scheduler picks it
-        }
+    fw_destroy(&tc.fw);
+    fr_destroy(&fr);
+    pthread_mutex_destroy(&tc.lock);
+    pthread_cond_destroy(&tc.idle);
+    close(cfd);
+    conn_release();
+    record_event(REC_CLOSE, tc.client_id, 0, 0, NULL, 0);
+}
 
-        pthread_cond_signal(&sched_cond); // Notify scheduler
-        
-        // Wait for Execution
-        while (j.status != JOB_FINISHED) {
-            // Wait for turn
-            while (!j.my_turn) {
-                pthread_cond_wait(&j.cond, &sched_lock);
-            }
-            // "I have the lock and it's my turn"
-            if (j.is_shell_cmd) {
-                log_line_prefixed("INFO", prefix, "--- started (-1)");
-                // Execute fully
-                pthread_mutex_unlock(&sched_lock); // Release lock during exec
-                execute_shell_job(&j);
-                pthread_mutex_lock(&sched_lock);   // Reacquire to update state
-                
-                log_line_prefixed("INFO", prefix, "--- ended (-1)");
-                // IMPORTANT: shell commands are NOT part of the Gantt diagram
-                // so we do NOT call append_timeline() here.
-            } else {
-                // Program Execution
-                int quantum = (j.rounds_run == 0) ? 3 : 7;
-                j.rounds_run++;
-                
-                // Drop the global scheduler lock while running this quantum,
-                // so other clients can enqueue jobs and the scheduler can see them.
-                pthread_mutex_unlock(&sched_lock);
-                execute_demo_job(&j, quantum);
-                pthread_mutex_lock(&sched_lock);
-            }
-            
-            cpu_busy = false;  // CPU is now free for someone else
-            current_job = NULL;
-            j.my_turn = false; // Yield back to scheduler
-            pthread_cond_signal(&sched_cond);  // wake scheduler to pick next job
+// Accepts clients on one listening socket (TCP or unix), a thread each
+static void *accept_thread_func(void *arg) {
+    int lfd = (int)(intptr_t)arg;
+    while (1) {
+        int cfd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+        if (cfd < 0) {
+            if (errno == EMFILE || errno == ENFILE) usleep(1000);
+            continue;
         }
-        
-        remove_job(&j);
-        pthread_mutex_unlock(&sched_lock);
-        
-        pthread_cond_destroy(&j.cond);
-        free(cmd);
-        
-        // If queue empty, print timeline
-        if (job_queue == NULL) {
-             print_timeline();
+        if (!conn_admit(cfd)) { close(cfd); continue; }
+
+        if (pool_submit(g_pool, client_conn_func, (void*)(intptr_t)cfd) < 0) {
+            // All --pool-max workers hold a connection: don't leave this
+            // one waiting without an answer
+            __atomic_add_fetch(&g_rejected_conns, 1, __ATOMIC_RELAXED);
+            send_conn_busy(cfd);
+            close(cfd);
+            conn_release();
         }
     }
+    return NULL;
+}
 
-    close(cfd);
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [options] [port]\n"
+        "  -m, --mode=threads|reactor   connection handling model (default threads)\n"
+        "  -r, --reactors=N             epoll threads in reactor mode (default 1)\n"
+        "  -i, --io=net|uring           I/O backend for frames and pipes (default net)\n"
+        "  -w, --write-mode=latency|throughput\n"
+        "                               send every frame at once, or coalesce small ones\n"
+        "      --coalesce-bytes=N       throughput mode: flush once N bytes are pending (16384)\n"
+        "      --coalesce-us=N          throughput mode: flush frames older than N us (2000)\n"
+        "  -z, --zero-copy              splice shell output from the child pipe to the socket\n"
+        "      --max-frame=BYTES        largest accepted command frame (default 1 MiB)\n"
+        "      --max-inflight=N         commands in flight per multiplexed connection (64)\n"
+        "      --compress-min=BYTES     compress output frames from this size on, for\n"
+        "                               clients that ask for it (512; 0 = never)\n"
+        "  -u, --unix=PATH              also accept local clients on a unix socket\n"
+        "  -a, --accept-shards=N        N SO_REUSEPORT listeners with an acceptor each (1)\n"
+        "      --backlog=N              listen() backlog per socket (1024)\n"
+        "      --max-conns=N            reject connections beyond N (0 = no limit)\n"
+        "      --max-queued-jobs=N      reject commands while N jobs are queued (0 = no limit)\n"
+        "      --max-queued-work=N      reject commands that would push queued work\n"
+        "                               (sum of remaining time units) past N (0 = no limit)\n"
+        "      --pool-min=N             threads mode: connection workers kept alive (4)\n"
+        "      --pool-max=N             threads mode: most connections served at once,\n"
+        "                               later ones get a busy reply; also the most commands\n"
+        "                               of multiplexed connections waiting or running at\n"
+        "                               once, beyond which their connections stop being read\n"
+        "                               (1024; unlike one thread per connection, this caps\n"
+        "                               the clients served at once: raise it, or use\n"
+        "                               --mode=reactor, for more)\n"
+        "      --stack-size=KB          stack of connection and job threads (256)\n"
+        "      --record=FILE            log received frames and command completions\n"
+        "                               to FILE, for ./replay\n"
+        "      --cpus=N                 run up to N jobs at once, one run queue per CPU (1)\n"
+        "      --affinity=CPUS          keep server threads on CPUS (e.g. 0 or 0-1) and pin\n"
+        "                               each job to one of the other cores, by its CPU;\n"
+        "                               combine with --cpus=N to use more than one core\n"
+        "      --quantum-mode=lines|wall|cpu\n"
+        "                               a time unit is an output line (default), a tick of\n"
+        "                               --unit-ms wall time, or --unit-ms of the job's CPU time\n"
+        "      --unit-ms=MS             length of a unit in wall/cpu mode (1000)\n",
+        prog);
+}
+
+// With --record, SIGINT/SIGTERM are taken by a thread that flushes the log
+// before letting the signal kill the server as usual.
+static void *record_signal_func(void *arg) {
+    sigset_t *set = arg;
+    int sig;
+    if (sigwait(set, &sig) != 0) return NULL;
+    record_close();
+    signal(sig, SIG_DFL);
+    pthread_sigmask(SIG_UNBLOCK, set, NULL);
+    raise(sig);
     return NULL;
 }
 
+static void start_record_signal_thread(void) {
+    static sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    // Blocked before any other thread exists, so they all inherit it
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    pthread_t tid;
+    pthread_create(&tid, NULL, record_signal_func, &set);
+}
+
+static int parse_args(int argc, char **argv) {
+    static const struct option opts[] = {
+        {"mode",     required_argument, NULL, 'm'},
+        {"reactors", required_argument, NULL, 'r'},
+        {"io",       required_argument, NULL, 'i'},
+        {"write-mode",     required_argument, NULL, 'w'},
+        {"coalesce-bytes", required_argument, NULL, 1000},
+        {"coalesce-us",    required_argument, NULL, 1001},
+        {"zero-copy",      no_argument,       NULL, 'z'},
+        {"max-frame",      required_argument, NULL, 1002},
+        {"max-inflight",   required_argument, NULL, 1003},
+        {"compress-min",   required_argument, NULL, 1004},
+        {"unix",           required_argument, NULL, 'u'},
+        {"accept-shards",  required_argument, NULL, 'a'},
+        {"backlog",        required_argument, NULL, 1005},
+        {"max-conns",      required_argument, NULL, 1006},
+        {"max-queued-jobs", required_argument, NULL, 1007},
+        {"max-queued-work", required_argument, NULL, 1008},
+        {"pool-min",       required_argument, NULL, 1009},
+        {"pool-max",       required_argument, NULL, 1010},
+        {"stack-size",     required_argument, NULL, 1011},
+        {"record",         required_argument, NULL, 1012},
+        {"cpus",           required_argument, NULL, 1013},
+        {"affinity",       required_argument, NULL, 1014},
+        {"quantum-mode",   required_argument, NULL, 1015},
+        {"unit-ms",        required_argument, NULL, 1016},
+        {"help",     no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "m:r:i:w:zu:a:h", opts, NULL)) != -1) {
+        switch (c) {
+        case 'm':
+            if (strcmp(optarg, "threads") == 0)      g_cfg.mode = MODE_THREADS;
+            else if (strcmp(optarg, "reactor") == 0) g_cfg.mode = MODE_REACTOR;
+            else { usage(argv[0]); return -1; }
+            break;
+        case 'r':
+            g_cfg.reactors = atoi(optarg);
+            if (g_cfg.reactors < 1) g_cfg.reactors = 1;
+            break;
+        case 'i':
+            if (strcmp(optarg, "net") == 0)        g_cfg.io = IO_BACKEND_NET;
+            else if (strcmp(optarg, "uring") == 0) g_cfg.io = IO_BACKEND_URING;
+            else { usage(argv[0]); return -1; }
+            break;
+        case 'w':
+            if (strcmp(optarg, "latency") == 0)         g_cfg.write_mode = FW_LATENCY;
+            else if (strcmp(optarg, "throughput") == 0) g_cfg.write_mode = FW_THROUGHPUT;
+            else { usage(argv[0]); return -1; }
+            break;
+        case 'z':
+            g_cfg.zero_copy = true;
+            break;
+        case 1000:
+            g_cfg.coalesce_bytes = (size_t)atol(optarg);
+            break;
+        case 1001:
+            g_cfg.coalesce_us = (unsigned)atol(optarg);
+            break;
+        case 1002:
+            g_cfg.max_frame = (size_t)atol(optarg);
+            break;
+        case 1003:
+            g_cfg.max_inflight = atoi(optarg);
+            if (g_cfg.max_inflight < 1) g_cfg.max_inflight = 1;
+            break;
+        case 1004:
+            g_cfg.compress_min = (size_t)atol(optarg);
+            break;
+        case 'u':
+            g_cfg.unix_path = optarg;
+            break;
+        case 'a':
+            g_cfg.accept_shards = atoi(optarg);
+            if (g_cfg.accept_shards < 1) g_cfg.accept_shards = 1;
+            break;
+        case 1005:
+            g_cfg.backlog = atoi(optarg);
+            if (g_cfg.backlog < 1) g_cfg.backlog = 1;
+            break;
+        case 1006:
+            g_cfg.max_conns = atoi(optarg);
+            break;
+        case 1007:
+            sched_max_jobs = atoi(optarg);
+            break;
+        case 1008:
+            sched_max_work = atoi(optarg);
+            break;
+        case 1009:
+            g_cfg.pool_min = atoi(optarg);
+            if (g_cfg.pool_min < 0) g_cfg.pool_min = 0;
+            break;
+        case 1010:
+            g_cfg.pool_max = atoi(optarg);
+            if (g_cfg.pool_max < 1) g_cfg.pool_max = 1;
+            break;
+        case 1011:
+            g_cfg.stack_kb = atoi(optarg);
+            // PTHREAD_STACK_MIN plus room for the fork()ed pipeline setup
+            if (g_cfg.stack_kb < 64) g_cfg.stack_kb = 64;
+            break;
+        case 1012:
+            g_cfg.record_path = optarg;
+            break;
+        case 1013:
+            g_cfg.cpus = atoi(optarg);
+            if (g_cfg.cpus < 1) g_cfg.cpus = 1;
+            break;
+        case 1014:
+            g_cfg.affinity = optarg;
+            break;
+        case 1015:
+            if (strcmp(optarg, "lines") == 0)     g_cfg.quantum_mode = QUANTUM_LINES;
+            else if (strcmp(optarg, "wall") == 0) g_cfg.quantum_mode = QUANTUM_WALL;
+            else if (strcmp(optarg, "cpu") == 0)  g_cfg.quantum_mode = QUANTUM_CPU;
+            else { usage(argv[0]); return -1; }
+            break;
+        case 1016:
+            g_cfg.unit_ms = atoi(optarg);
+            if (g_cfg.unit_ms < 1) g_cfg.unit_ms = 1;
+            sched_unit_ms = g_cfg.unit_ms;
+            break;
+        default:
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (optind < argc) g_cfg.port = atoi(argv[optind]);
+    return 0;
+}
+
 int main(int argc, char **argv) {
     struct sigaction sa;
     memset(&sa, 0, sizeof(sa));
     sa.sa_handler = SIG_IGN;  // ignore SIGPIPE globally (this is useful so that the server doesn't crash when client does CTRL+C)
     sigaction(SIGPIPE, &sa, NULL);
 
-    uint16_t port = 5050;
-    if (argc > 1) port = atoi(argv[1]);
+    if (parse_args(argc, argv) < 0) return 1;
+
+    if (g_cfg.affinity) {
+        if (affinity_init(g_cfg.affinity) < 0) {
+            fprintf(stderr, "bad --affinity core list: %s\n", g_cfg.affinity);
+            return 1;
+        }
+        // Before any thread exists, so they all inherit the control cores
+        affinity_pin_control();
+        LOG_INFO("affinity: server threads on %s, jobs on %d worker core(s)",
+                 g_cfg.affinity, affinity_workers());
+    }
+
+    IoBackend io = io_set_backend(g_cfg.io);
+    if (io != g_cfg.io) {
+        LOG_INFO("io_uring not available, falling back to %s I/O", io_backend_name(io));
+    }
+    fw_configure(g_cfg.write_mode, g_cfg.coalesce_bytes, g_cfg.coalesce_us);
+    fw_set_compress_min(g_cfg.compress_min);
+    if (g_cfg.record_path) {
+        if (record_open(g_cfg.record_path) < 0) { perror(g_cfg.record_path); return 1; }
+        start_record_signal_thread();
+    }
     
-    int lfd = tcp_listen(port);
-    if (lfd < 0) return 1;
+    // TCP listener(s) first, then the unix one
+    int *lfds = malloc(sizeof(int) * (g_cfg.accept_shards + 1));
+    int nlfds = g_cfg.accept_shards;
+    if (!lfds) return 1;
+    if (nlfds == 1) lfds[0] = tcp_listen_backlog(g_cfg.port, g_cfg.backlog, false);
+    else if (tcp_listen_shards(g_cfg.port, g_cfg.backlog, nlfds, lfds) < 0) lfds[0] = -1;
+    if (lfds[0] < 0) { perror("listen"); return 1; }
+    if (g_cfg.unix_path) {
+        lfds[nlfds] = unix_listen(g_cfg.unix_path, g_cfg.backlog);
+        if (lfds[nlfds] < 0) { perror(g_cfg.unix_path); return 1; }
+        nlfds++;
+    }
     
     // UI Header
     printf("\n-------------------------\n");
     printf("| Hello, Server Started |\n");
     printf("-------------------------\n\n");
+    fflush(stdout);  // children forked later must not inherit the buffered banner
     
-    scheduler_init();
+    scheduler_init(g_cfg.cpus);
+
+    if (g_cfg.mode == MODE_REACTOR) {
+        // Event loops own the sockets; an executor thread per CPU replaces
+        // the scheduler thread + per-client waiters.
+        return reactor_run(lfds, nlfds, g_cfg.reactors);
+    }
+
+    g_pool = pool_create(g_cfg.pool_min, g_cfg.pool_max,
+                         (size_t)g_cfg.stack_kb * 1024, POOL_IDLE_MS);
+    // No more commands than the handoff queue holds, so submits never fail
+    int job_slots = g_cfg.pool_max < POOL_QUEUE_SIZE ? g_cfg.pool_max : POOL_QUEUE_SIZE;
+    g_job_pool = pool_create(0, job_slots, (size_t)g_cfg.stack_kb * 1024, POOL_IDLE_MS);
+    sem_init(&g_job_slots, 0, (unsigned)job_slots);
+    if (!g_pool || !g_job_pool) { perror("pool"); return 1; }
+    pool_set_done(g_job_pool, job_slot_free, &g_job_slots);
 
     // Spawn Scheduler
     pthread_t stid;
     pthread_create(&stid, NULL, scheduler_thread_func, NULL);
 
-    while (1) {
-        struct sockaddr_in peer; socklen_t len = sizeof(peer);
-        int cfd = accept(lfd, (struct sockaddr*)&peer, &len);
-        if (cfd < 0) continue;
-        
-        pthread_t tid;
-        pthread_create(&tid, NULL, client_thread_func, (void*)(intptr_t)cfd);
+    // One acceptor per listening socket; the first one runs here
+    for (int i = 1; i < nlfds; i++) {
+        pthread_t atid;
+        pthread_create(&atid, NULL, accept_thread_func, (void*)(intptr_t)lfds[i]);
     }
+    accept_thread_func((void*)(intptr_t)lfds[0]);
     return 0;
-}
\ No newline at end of file
+}
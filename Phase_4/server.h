@@ -0,0 +1,85 @@
+#ifndef SERVER_H
+#define SERVER_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "scheduler.h"
+#include "io.h"
+#include "frame.h"
+
+// How client connections are serviced
+typedef enum {
+    MODE_THREADS,   // one blocking thread per connection (original design)
+    MODE_REACTOR    // epoll event loops + an executor thread per CPU
+} ServerMode;
+
+// What a scheduler time unit is when running a program (--quantum-mode)
+typedef enum {
+    QUANTUM_LINES,  // one line of output (original; matches existing Gantt charts)
+    QUANTUM_WALL,   // unit_ms of wall time while it holds the CPU (timerfd)
+    QUANTUM_CPU     // unit_ms of the child's CPU time, checked every unit_ms
+} QuantumMode;
+
+// Runtime configuration, filled in from the command line in main()
+typedef struct {
+    uint16_t port;
+    ServerMode mode;
+    int reactors;   // number of epoll threads in MODE_REACTOR
+    IoBackend io;   // requested I/O backend (falls back to net)
+    FwMode write_mode;          // latency: write each frame; throughput: coalesce
+    size_t coalesce_bytes;      // throughput mode size threshold
+    unsigned coalesce_us;       // throughput mode deadline
+    bool zero_copy;             // splice shell output instead of copying it
+    size_t max_frame;           // reject command frames larger than this
+    int max_inflight;           // per-connection window for multiplexed commands
+    size_t compress_min;        // smallest output frame worth compressing (0 = off)
+    const char *unix_path;      // also listen on this AF_UNIX socket (local mode)
+    int accept_shards;          // SO_REUSEPORT listeners, one acceptor thread each
+    int backlog;                // listen() backlog per listening socket
+    int max_conns;              // admission: open connections (0 = no limit)
+    int pool_min, pool_max;     // threads mode: connection worker bounds
+    int stack_kb;               // stack size of connection and job threads
+    const char *record_path;    // --record: traffic log (record.h), or NULL
+    int cpus;                   // virtual CPUs: jobs that run at the same time
+    const char *affinity;       // --affinity: cores kept for server threads, or NULL
+    QuantumMode quantum_mode;   // how slices are measured and charged
+    int unit_ms;                // wall/cpu mode: length of a time unit
+} ServerConfig;
+
+extern ServerConfig g_cfg;
+
+// Logging helper shared by both connection modes
+void log_line_prefixed(const char *tag, const char *prefix, const char *fmt, ...);
+
+// Returns a fresh client id (thread-safe)
+int next_client_id(void);
+
+// Connection admission: false (busy reply already sent, caller closes the
+// socket) when --max-conns is reached. Every admitted connection must call
+// conn_release() once it is closed.
+bool conn_admit(int cfd);
+void conn_release(void);
+
+// Strips the trailing newline off a received frame and returns it as the
+// command string (points into the frame reader's buffer).
+char *command_from_frame(FrameView *v);
+
+// Fills in a Job for command `cmd` received from client `client_id` on `fd`.
+// Output frames go through `out`. `cmd` is borrowed and must outlive the job.
+void job_setup(Job *j, int client_id, int fd, FrameWriter *out, char *cmd);
+
+// Handles a control frame: "\0HELLO ..." replies and switches the framing
+// of `fr`/`fw`, "\0FDS" attaches passed descriptors, "\0STATS" reports load.
+void handle_control_frame(FrameView *v, FrameReader *fr, FrameWriter *fw, const char *prefix);
+
+// Submits `j` and blocks the calling thread until it has finished (or
+// rejects it right away if the queue is over its limits)
+void run_job_blocking(Job *j);
+
+// Sends the "busy, retry after" answer for a job admit_job() refused
+void reject_job(Job *j, AdmitResult r, unsigned retry_ms);
+
+// Runs one scheduling slice of `j` (whole command for shell jobs,
+// one quantum for programs). Must be called WITHOUT sched_lock held.
+void run_job_slice(Job *j);
+
+#endif
@@ -0,0 +1,354 @@
+// sim.c - deterministic discrete-event simulator for the SRJF + RR scheduler.
+//
+// Drives scheduler.c (add_job / get_next_job / slice_done and the timeline)
+// exactly the way the server's scheduler loop does, but on a virtual clock:
+// no fork, no sockets, no sleeps. One time unit is one demo line. A program
+// runs job_quantum() units per slice and checks preempt_requested before
+// every unit, as execute_demo_job() does; arrivals that fall inside a unit
+// are submitted at the end of it (unless a CPU is idle). Shell commands run
+// to completion and take --shell-cost units (0 by default; they are not part
+// of the Gantt chart). With --cpus=N, N CPUs run side by side, one Gantt
+// line each.
+//
+// Jobs come from a trace file, one per line, "<arrival> <client> <command>":
+//   0   1 ./demo 5
+//   1.5 2 ls -l
+// or from a synthetic trace (-g N): Poisson arrivals sized for --load,
+// bursts uniform in 1..--max-burst, a --shell fraction of shell commands.
+// Same options and seed, same output.
+//
+// Prints the Gantt chart (print_timeline(), once per busy period, as the
+// server does) and average response, waiting and turnaround times.
+//
+// Usage: ./sim [-f trace | -g jobs] [options], see usage()
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <getopt.h>
+#include <math.h>
+#include "scheduler.h"
+
+typedef struct {
+    double arrival;
+    double first_run;           // -1 until the job gets the CPU
+    double finish;
+    double service;             // CPU units it needed
+} SimStats;
+
+typedef struct {
+    Job *jobs;
+    SimStats *st;
+    int n, cap;
+} Trace;
+
+typedef struct {
+    int n;
+    double response, waiting, turnaround, max_response;
+} Totals;
+
+static double g_shell_cost;
+static bool g_gantt = true;
+static uint64_t g_rng = 1;
+
+// xorshift64*, so a seed gives the same trace on every libc
+static double rnd(void) {
+    g_rng ^= g_rng >> 12;
+    g_rng ^= g_rng << 25;
+    g_rng ^= g_rng >> 27;
+    return ((g_rng * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static Job *trace_add(Trace *t, double arrival, int client, const char *cmd) {
+    if (t->n == t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 1024;
+        t->jobs = realloc(t->jobs, t->cap * sizeof(Job));
+        t->st = realloc(t->st, t->cap * sizeof(SimStats));
+        if (!t->jobs || !t->st) { perror("realloc"); exit(1); }
+    }
+    Job *j = &t->jobs[t->n];
+    memset(j, 0, sizeof(*j));
+    j->id = client;
+    j->status = JOB_WAITING;
+    job_classify(j, cmd);
+    if (!j->is_shell_cmd && j->total_time < 1) j->total_time = j->remaining_time = 1;
+    t->st[t->n] = (SimStats){ arrival, -1, 0, j->is_shell_cmd ? g_shell_cost : j->total_time };
+    t->n++;
+    return j;
+}
+
+static int load_trace(Trace *t, const char *file) {
+    FILE *f = fopen(file, "r");
+    if (!f) { perror(file); return -1; }
+    char line[1024];
+    int lineno = 0;
+    double last = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        line[strcspn(line, "\r\n")] = '\0';
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0' || *p == '#') continue;
+        double arrival;
+        int client, off;
+        if (sscanf(p, "%lf %d %n", &arrival, &client, &off) != 2 || p[off] == '\0') {
+            fprintf(stderr, "%s:%d: expected \"<arrival> <client> <command>\"\n", file, lineno);
+            fclose(f);
+            return -1;
+        }
+        if (arrival < last) {
+            fprintf(stderr, "%s:%d: arrivals must be in time order\n", file, lineno);
+            fclose(f);
+            return -1;
+        }
+        last = arrival;
+        trace_add(t, arrival, client, p + off);
+    }
+    fclose(f);
+    return 0;
+}
+
+static void gen_trace(Trace *t, int njobs, double load, int ncpus, int max_burst,
+                      double shell_frac) {
+    // Mean work per arrival, so that arrivals keep each of the CPUs `load` busy
+    double mean_work = (1 - shell_frac) * (1 + max_burst) / 2.0 + shell_frac * g_shell_cost;
+    double gap = mean_work / (load * ncpus), now = 0;
+    char cmd[32];
+    for (int i = 0; i < njobs; i++) {
+        if (rnd() < shell_frac) snprintf(cmd, sizeof(cmd), "ls");
+        else snprintf(cmd, sizeof(cmd), "./demo %d", 1 + (int)(rnd() * max_burst));
+        trace_add(t, now, i + 1, cmd);
+        now += -log(1.0 - rnd()) * gap;
+    }
+}
+
+static void save_trace(const Trace *t, const char *file) {
+    FILE *f = fopen(file, "w");
+    if (!f) { perror(file); return; }
+    for (int i = 0; i < t->n; i++) {
+        const Job *j = &t->jobs[i];
+        if (j->is_shell_cmd) fprintf(f, "%.3f %d ls\n", t->st[i].arrival, j->id);
+        else fprintf(f, "%.3f %d ./demo %d\n", t->st[i].arrival, j->id, j->total_time);
+    }
+    fclose(f);
+}
+
+// Submits every job that has arrived by `now`; returns the next index
+static int admit_arrivals(Trace *t, int next, double now) {
+    while (next < t->n && t->st[next].arrival <= now) add_job(&t->jobs[next++]);
+    return next;
+}
+
+typedef struct {
+    double now, busy;
+    unsigned long slices, preemptions;
+} Clock;
+
+// A virtual CPU as seen by the simulator: the slice it is in the middle of
+typedef struct {
+    Job *job;                   // NULL while idle
+    int used, quantum;          // units of the current slice
+    double t;                   // end of the unit (or shell command) under way
+} Core;
+
+// A CPU picked j, as the scheduler thread hands it a turn
+static void start_slice(Trace *t, Core *k, Job *j, Clock *c) {
+    SimStats *s = &t->st[j - t->jobs];
+    if (s->first_run < 0) s->first_run = c->now;
+    c->slices++;
+    j->status = JOB_RUNNING;
+    k->job = j;
+    k->used = 0;
+    if (j->is_shell_cmd) {
+        // Runs to completion, no preemption checks
+        k->t = c->now + g_shell_cost;
+        c->busy += g_shell_cost;
+    } else {
+        k->quantum = job_quantum(j);
+        j->rounds_run++;
+        k->t = c->now;
+    }
+}
+
+// The CPU gives the job back, as run_job_blocking() does after a slice
+static void end_slice(Trace *t, Core *k, int cpu, Clock *c, int *done) {
+    Job *j = k->job;
+    k->job = NULL;
+    if (j->is_shell_cmd) {
+        j->status = JOB_FINISHED;
+    } else {
+        if (j->remaining_time > 0) j->preempt_requested = 0;
+        else j->status = JOB_FINISHED;
+        if (g_gantt) append_timeline(cpu, j->id, k->used);
+    }
+    bool finished = j->status == JOB_FINISHED;
+    if (finished) {
+        t->st[j - t->jobs].finish = c->now;
+        (*done)++;
+    } else {
+        j->status = JOB_WAITING;
+    }
+    slice_done(j);
+    if (finished && !queued_jobs && g_gantt) print_timeline();
+}
+
+// A busy CPU at the end of a unit: checks preempt_requested before the next
+// one, as execute_demo_job() does, or ends the slice
+static void step_core(Trace *t, Core *k, int cpu, Clock *c, int *done) {
+    Job *j = k->job;
+    if (!j->is_shell_cmd && k->used < k->quantum && j->remaining_time > 0) {
+        if (!j->preempt_requested) {
+            k->t = c->now + 1;
+            c->busy += 1;
+            j->remaining_time--;
+            k->used++;
+            return;
+        }
+        c->preemptions++;
+    }
+    end_slice(t, k, cpu, c, done);
+}
+
+static void simulate(Trace *t, Core *cores, Clock *c) {
+    int next = 0, done = 0;
+    while (done < t->n) {
+        next = admit_arrivals(t, next, c->now);
+
+        // Everything that happens at `now`: units end, CPUs pick (or
+        // steal) and start their next unit, until no CPU can start more
+        bool again = true;
+        while (again) {
+            again = false;
+            for (int i = 0; i < sched_ncpus; i++) {
+                Core *k = &cores[i];
+                if (k->job && k->t <= c->now) step_core(t, k, i, c, &done);
+                if (!k->job && cpu_can_run(i)) {
+                    start_slice(t, k, get_next_job(i), c);
+                    again = true;
+                }
+            }
+        }
+
+        // Next event: the first unit to end, or an arrival while a CPU is
+        // idle. Arrivals during a unit on busy CPUs are submitted at its end.
+        double when = INFINITY;
+        bool idle = false;
+        for (int i = 0; i < sched_ncpus; i++) {
+            if (!cores[i].job) idle = true;
+            else if (cores[i].t < when) when = cores[i].t;
+        }
+        if (idle && next < t->n && t->st[next].arrival < when) when = t->st[next].arrival;
+        if (when == INFINITY) break;
+        c->now = when;
+    }
+}
+
+static void tally(Totals *tot, const SimStats *s) {
+    double response = s->first_run - s->arrival, turnaround = s->finish - s->arrival;
+    tot->n++;
+    tot->response += response;
+    tot->turnaround += turnaround;
+    tot->waiting += turnaround - s->service;
+    if (response > tot->max_response) tot->max_response = response;
+}
+
+static void report(const char *name, const Totals *tot) {
+    if (!tot->n) return;
+    printf("  %-9s %8d %10.2f %10.2f %12.2f %12.2f\n", name, tot->n, tot->response / tot->n,
+           tot->waiting / tot->n, tot->turnaround / tot->n, tot->max_response);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [-f TRACE | -g JOBS] [options]\n"
+        "  -f, --trace=FILE      jobs from FILE, \"<arrival> <client> <command>\" per line\n"
+        "  -g, --generate=N      synthetic trace of N jobs\n"
+        "  -l, --load=X          offered load per CPU of the synthetic trace (0.9)\n"
+        "  -b, --max-burst=N     demo bursts uniform in 1..N (20)\n"
+        "      --shell=FRAC      fraction of shell commands (0.2)\n"
+        "  -s, --seed=N          random seed (1)\n"
+        "  -c, --cpus=N          CPUs, each with its own run queue (1)\n"
+        "      --shell-cost=U    time units a shell command takes (0)\n"
+        "  -o, --save=FILE       write the trace that was simulated\n"
+        "  -q, --quiet           no Gantt chart, only the averages\n",
+        prog);
+}
+
+int main(int argc, char **argv) {
+    static const struct option opts[] = {
+        {"trace",      required_argument, NULL, 'f'},
+        {"generate",   required_argument, NULL, 'g'},
+        {"load",       required_argument, NULL, 'l'},
+        {"max-burst",  required_argument, NULL, 'b'},
+        {"shell",      required_argument, NULL, 1000},
+        {"seed",       required_argument, NULL, 's'},
+        {"cpus",       required_argument, NULL, 'c'},
+        {"shell-cost", required_argument, NULL, 1001},
+        {"save",       required_argument, NULL, 'o'},
+        {"quiet",      no_argument,       NULL, 'q'},
+        {"help",       no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    const char *file = NULL, *save = NULL;
+    int njobs = 0, max_burst = 20, ncpus = 1;
+    double load = 0.9, shell_frac = 0.2;
+    int c;
+    while ((c = getopt_long(argc, argv, "f:g:l:b:s:c:o:qh", opts, NULL)) != -1) {
+        switch (c) {
+        case 'f': file = optarg; break;
+        case 'g': njobs = atoi(optarg); break;
+        case 'l': load = atof(optarg); break;
+        case 'b': max_burst = atoi(optarg); break;
+        case 1000: shell_frac = atof(optarg); break;
+        case 's': g_rng = strtoull(optarg, NULL, 10) | 1; break;
+        case 'c': ncpus = atoi(optarg); break;
+        case 1001: g_shell_cost = atof(optarg); break;
+        case 'o': save = optarg; break;
+        case 'q': g_gantt = false; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (!file && njobs <= 0) { usage(argv[0]); return 1; }
+    if (load <= 0 || ncpus < 1 || max_burst < 1 || shell_frac < 0 || shell_frac > 1 || g_shell_cost < 0) {
+        fprintf(stderr, "bad trace parameters\n");
+        return 1;
+    }
+
+    Trace t = { 0 };
+    if (file) {
+        if (load_trace(&t, file) < 0) return 1;
+    } else {
+        gen_trace(&t, njobs, load, ncpus, max_burst, shell_frac);
+    }
+    if (t.n == 0) { fprintf(stderr, "empty trace\n"); return 1; }
+    if (save) save_trace(&t, save);
+
+    scheduler_init(ncpus);
+    Core *cores = calloc(ncpus, sizeof(Core));
+    if (!cores) { perror("calloc"); return 1; }
+    Clock clk = { 0 };
+    simulate(&t, cores, &clk);
+
+    Totals all = { 0 }, progs = { 0 }, shells = { 0 };
+    for (int i = 0; i < t.n; i++) {
+        tally(&all, &t.st[i]);
+        tally(t.jobs[i].is_shell_cmd ? &shells : &progs, &t.st[i]);
+    }
+    printf("%d jobs, %.0f time units, CPU busy %.1f%%, %lu slices, %lu preemptions\n", t.n,
+           clk.now, clk.now > 0 ? clk.busy * 100 / (clk.now * ncpus) : 0.0, clk.slices,
+           clk.preemptions);
+    if (ncpus > 1) {
+        printf("%d CPUs, %.3f jobs per time unit\n", ncpus, clk.now > 0 ? t.n / clk.now : 0.0);
+    }
+    printf("  %-9s %8s %10s %10s %12s %12s\n", "", "jobs", "response", "waiting", "turnaround",
+           "max resp.");
+    report("programs", &progs);
+    report("shell", &shells);
+    report("all", &all);
+    free(cores);
+    free(t.jobs);
+    free(t.st);
+    return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef URING_H
+#define URING_H
+#include <stdint.h>
+#include <stddef.h>
+#include <linux/io_uring.h>
+
+// Minimal io_uring ring built directly on the raw syscalls, so the tree does
+// not depend on liburing. Only what the io backend needs: grab SQEs, submit
+// them in one io_uring_enter() and reap completions.
+typedef struct {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_sz, cq_sz, sqes_sz;
+    unsigned pending;            // SQEs queued but not yet submitted
+} URing;
+
+int uring_setup(URing *r, unsigned entries);     // 0 on success, -1 (errno) on failure
+void uring_destroy(URing *r);
+
+// Returns a zeroed SQE, or NULL if the submission queue is full
+struct io_uring_sqe *uring_get_sqe(URing *r);
+
+// Submits all pending SQEs and waits for at least `wait_nr` completions.
+// One syscall. Returns number submitted or -1.
+int uring_submit_and_wait(URing *r, unsigned wait_nr);
+
+// Pops one completion if available: returns 1 and fills the outputs, 0 if empty
+int uring_reap(URing *r, uint64_t *user_data, int *res);
+
+#endif
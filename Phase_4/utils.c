@@ -292,12 +292,22 @@ int build_pipeline(char **tokens, Stage **stages_out, int *nstages_out, const ch
     return stages;
 }
 
+// Turns a waitpid() status into a shell-style exit code (128+N for signal N)
+int exit_code_from_status(int status) {
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 1;
+}
+
 /*
  * Executes an n-stage pipeline (S[0..n-1]) using fork/pipe/dup2.
  * input is S (stages with argv + redirs) and n (# of stages)
- * function returns 0 on success, -1 on immediate setup failure (e.g., pipe/fork OOM)
+ * function returns the exit code of the last stage (like a shell's $?),
+ * or -1 on immediate setup failure (e.g., pipe/fork OOM)
 */
 int exec_pipeline(Stage *S, int n, int err_fd) {
+    if (n < 1) return -1;  // no stages: nothing to run
+
     // if just one stage -> no pipes, only redirs + exec
     if (n == 1) {
         pid_t pid = fork();
@@ -324,6 +334,7 @@ int exec_pipeline(Stage *S, int n, int err_fd) {
                 close(fd);
             }
             if (execvp(S[0].argv[0], S[0].argv) == -1) {
+                int exec_errno = errno;  // the messages below may clobber errno
                 if (errno == ENOENT) {
                     if (S[0].argv[0][0] == '.' && S[0].argv[0][1] == '/') {               // in order to immitate bash behavior, we check if 
                         fprintf(stderr, "%s: No such file or directory\n", S[0].argv[0]); // the executable exists, so we can give identical err msg
@@ -339,12 +350,12 @@ int exec_pipeline(Stage *S, int n, int err_fd) {
                     fprintf(stderr, "%s: %s\n", S[0].argv[0], strerror(errno));
                     err_write(err_fd, "%s: %s", S[0].argv[0], strerror(errno));
                 }
-                exit(EXIT_FAILURE);
+                exit(exec_errno == ENOENT ? 127 : 126);  // same codes as bash
             }
         }
         int status;
         waitpid(pid, &status, 0);
-        return 0;
+        return exit_code_from_status(status);
     }
 
     // n >= 2, 2 or more stages in a single command
@@ -409,6 +420,7 @@ int exec_pipeline(Stage *S, int n, int err_fd) {
 
             // exec the stage
             if (execvp(S[i].argv[0], S[i].argv) == -1) {
+                int exec_errno = errno;  // the messages below may clobber errno
                 if (errno == ENOENT) {
                     if (S[i].argv[0][0] == '.' && S[i].argv[0][1] == '/') {               // in order to immitate bash behavior, we check if 
                         fprintf(stderr, "%s: No such file or directory\n", S[i].argv[0]); // the executable exists, so we can give identical err msg
@@ -424,7 +436,7 @@ int exec_pipeline(Stage *S, int n, int err_fd) {
                     fprintf(stderr, "%s: %s\n", S[i].argv[0], strerror(errno));
                     err_write(err_fd, "%s: %s", S[i].argv[0], strerror(errno));
                 }
-                exit(EXIT_FAILURE);
+                exit(exec_errno == ENOENT ? 127 : 126);  // same codes as bash
             }
         }
     }
@@ -432,10 +444,11 @@ int exec_pipeline(Stage *S, int n, int err_fd) {
     // parent closes all pipe fds
     for (int k = 0; k < n-1; k++) { close(pfds[k][0]); close(pfds[k][1]); }
     free(pfds);
-    int status;
+    int status, last = 0;
     for (int i = 0; i < n; i++) {
         waitpid(pids[i], &status, 0);  // make sure no zombies
+        if (i == n-1) last = status;
     }
     free(pids);
-    return 0;
+    return exit_code_from_status(last);
 }
\ No newline at end of file
@@ -22,10 +22,13 @@ int parse_redirs(char **args, Redirs *R, char **errmsg);  // scan args to extrac
 int build_pipeline(char **tokens, Stage **stages_out, int *nstages_out, const char **errmsg);
 
 // execute an already-built pipeline
-// returns 0 on success; -1 on immediate setup failure
+// returns the last stage's exit code (>= 0); -1 on immediate setup failure
 // NEW argument: err_fd is the fd of the pipe for communicating error msgs between parent and child
 int exec_pipeline(Stage *stages, int nstages, int err_fd);
 
+// shell-style exit code for a waitpid() status: WEXITSTATUS, or 128+signal
+int exit_code_from_status(int status);
+
 // writes a formatted error message directly to a file descriptor (e.g., a pipe or stderr).
 // works like printf(), but instead of printing to stdout, it sends the formatted output
 // to the provided file descriptor. Useful for mirroring error messages to another process
@@ -0,0 +1,59 @@
+// wire.c - frame header and trailer encoding (see wire.h)
+#include "wire.h"
+
+uint32_t wire_get_u32(const char *p) {
+    const unsigned char *u = (const unsigned char *)p;
+    return (uint32_t)u[0] << 24 | (uint32_t)u[1] << 16 | (uint32_t)u[2] << 8 | u[3];
+}
+
+uint64_t wire_get_u64(const char *p) {
+    return (uint64_t)wire_get_u32(p) << 32 | wire_get_u32(p + 4);
+}
+
+void wire_put_u32(char *p, uint32_t v) {
+    for (int i = 3; i >= 0; i--) { p[i] = (char)(v & 0xff); v >>= 8; }
+}
+
+void wire_put_u64(char *p, uint64_t v) {
+    wire_put_u32(p, (uint32_t)(v >> 32));
+    wire_put_u32(p + 4, (uint32_t)v);
+}
+
+size_t frame_hdr_size(FrameFormat f) {
+    switch (f) {
+    case FRAME_TAGGED: return 8;
+    case FRAME_V2:     return FRAME_V2_HDR;
+    default:           return 4;
+    }
+}
+
+size_t frame_encode_hdr(FrameFormat f, uint32_t req_id, uint8_t type, uint8_t flags,
+                        uint32_t len, char *out) {
+    wire_put_u32(out, len);
+    if (f == FRAME_V1) return 4;
+    wire_put_u32(out + 4, req_id);
+    if (f == FRAME_TAGGED) return 8;
+    out[8] = (char)type;
+    out[9] = (char)flags;
+    out[10] = out[11] = 0;
+    return FRAME_V2_HDR;
+}
+
+void frame_decode_hdr(FrameFormat f, const char *in, FrameHdr *h) {
+    h->len = wire_get_u32(in);
+    h->req_id = f == FRAME_V1 ? 0 : wire_get_u32(in + 4);
+    h->type = f == FRAME_V2 ? (uint8_t)in[8] : FT_CMD;
+    h->flags = f == FRAME_V2 ? (uint8_t)in[9] : 0;
+}
+
+void frame_encode_timing(const FrameTiming *t, char out[FRAME_TIMING_SIZE]) {
+    wire_put_u64(out, t->queue_wait_us);
+    wire_put_u64(out + 8, t->run_us);
+    wire_put_u64(out + 16, t->turnaround_us);
+}
+
+void frame_decode_timing(const char in[FRAME_TIMING_SIZE], FrameTiming *t) {
+    t->queue_wait_us = wire_get_u64(in);
+    t->run_us = wire_get_u64(in + 8);
+    t->turnaround_us = wire_get_u64(in + 16);
+}
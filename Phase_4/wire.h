@@ -0,0 +1,83 @@
+#ifndef WIRE_H
+#define WIRE_H
+#include <stdint.h>
+#include <stddef.h>
+
+// ---------------------------------------------------------------------------
+// Wire formats.
+//   FRAME_V1     [u32 len][payload]                 (original protocol)
+//   FRAME_TAGGED [u32 len][u32 req_id][payload]     (v1 + "mux")
+//   FRAME_V2     [u32 len][u32 req_id][u8 type][u8 flags][u16 reserved][payload]
+// All integers are big-endian; len counts payload bytes only.
+//
+// Negotiation: the client's first frame may be a control frame whose payload
+// starts with a NUL byte (never a valid command): "\0HELLO <ver> [feature...]".
+// The server answers in the current format with the version and features it
+// accepted, and both sides switch formats after that exchange. V2 always
+// carries request ids, so it is multiplexed without asking for "mux".
+//
+// Shared by the server (frame.c), client.c and libclient.c.
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    FRAME_V1,
+    FRAME_TAGGED,
+    FRAME_V2
+} FrameFormat;
+
+// V2 frame types. In the older formats stdout and stderr are both plain
+// output frames, END is the empty frame, and EXIT/TIMING are not sent
+// (the server words BUSY as a text line there).
+typedef enum {
+    FT_CMD    = 0,  // client -> server: command (or control frame)
+    FT_STDOUT = 1,
+    FT_STDERR = 2,
+    FT_EXIT   = 3,  // payload: i32 exit status (128+N if killed by signal N)
+    FT_TIMING = 4,  // payload: FrameTiming, see frame_encode_timing()
+    FT_END    = 5,  // empty; last frame of a command
+    FT_BUSY   = 6   // payload: u32 retry-after ms; command was not queued
+} FrameType;
+
+// Server-side costs of one command, in microseconds
+typedef struct {
+    uint64_t queue_wait_us;  // time in the run queue (turnaround - run)
+    uint64_t run_us;         // time holding the CPU, summed over all slices
+    uint64_t turnaround_us;  // submission to completion
+} FrameTiming;
+
+// V2 flags. FF_COMPRESSED (after "lz" negotiation): payload is
+// [u32 raw_len][lz block], see lz.h.
+#define FF_COMPRESSED 0x01
+
+#define FRAME_MAX_HDR 16
+#define FRAME_V2_HDR 12
+#define FRAME_TIMING_SIZE 24
+#define FRAME_MAX_RAW (64u * 1024 * 1024)  // sanity cap for a compressed frame's raw_len
+#define PROTO_VERSION 2
+
+// A decoded header; fields a format lacks are 0 (type FT_CMD)
+typedef struct {
+    uint32_t len;
+    uint32_t req_id;
+    uint8_t type;
+    uint8_t flags;
+} FrameHdr;
+
+// Encodes a header into `out` (FRAME_MAX_HDR bytes); returns its size
+size_t frame_encode_hdr(FrameFormat f, uint32_t req_id, uint8_t type, uint8_t flags,
+                        uint32_t len, char *out);
+size_t frame_hdr_size(FrameFormat f);
+// Decodes the frame_hdr_size(f) bytes at `in`
+void frame_decode_hdr(FrameFormat f, const char *in, FrameHdr *h);
+
+// FT_TIMING payload: three u64, big-endian, in FrameTiming order
+void frame_encode_timing(const FrameTiming *t, char out[FRAME_TIMING_SIZE]);
+void frame_decode_timing(const char in[FRAME_TIMING_SIZE], FrameTiming *t);
+
+// Big-endian integers at unaligned addresses
+uint32_t wire_get_u32(const char *p);
+uint64_t wire_get_u64(const char *p);
+void wire_put_u32(char *p, uint32_t v);
+void wire_put_u64(char *p, uint64_t v);
+
+#endif
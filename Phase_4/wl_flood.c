@@ -0,0 +1,31 @@
+// wl_flood.c - output-heavy workload: each unit writes one long line of
+// `bytes` (64 KB by default) as fast as the pipe takes it, then idles out
+// the rest of the unit. One newline per unit keeps the server's
+// per-line accounting at one unit.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "workload.h"
+
+int main(int argc, char **argv) {
+    WlArgs a;
+    wl_parse(argc, argv, &a, "[bytes_per_unit]");
+    long bytes = argc > 3 ? atol(argv[3]) : 64 * 1024;
+    if (bytes < 1) bytes = 1;
+
+    char *line = malloc((size_t)bytes);
+    if (!line) { perror("malloc"); return 1; }
+    for (long i = 0; i < bytes - 1; i++) line[i] = 'a' + (char)(i % 26);
+    line[bytes - 1] = '\n';
+
+    for (int i = 0; i < a.units; i++) {
+        double start = wl_now_ms();
+        fwrite(line, 1, (size_t)bytes, stdout);
+        fflush(stdout);
+        double left = a.unit_ms - (wl_now_ms() - start);
+        if (left > 0) wl_sleep_ms((int)left);
+    }
+    free(line);
+    return 0;
+}
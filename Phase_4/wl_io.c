@@ -0,0 +1,43 @@
+// wl_io.c - bursty I/O waiter: each unit does a short burst of file I/O
+// (write + fdatasync + read back of a scratch file) and then sits in
+// poll() for the rest of the unit, like a job waiting on a device or the
+// network. Prints one line per unit.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include "workload.h"
+
+#define BURST_BYTES (256 * 1024)
+
+int main(int argc, char **argv) {
+    WlArgs a;
+    wl_parse(argc, argv, &a, NULL);
+
+    char path[] = "/tmp/wl_io.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) { perror("mkstemp"); return 1; }
+    unlink(path);
+    char *buf = malloc(BURST_BYTES);
+    if (!buf) { perror("malloc"); return 1; }
+    memset(buf, 'x', BURST_BYTES);
+
+    for (int i = 0; i < a.units; i++) {
+        double start = wl_now_ms();
+        if (pwrite(fd, buf, BURST_BYTES, 0) < 0 || fdatasync(fd) < 0 ||
+            pread(fd, buf, BURST_BYTES, 0) < 0) {
+            perror("io");
+            return 1;
+        }
+        // Wait out the unit with nothing ready, as a blocked reader would
+        double left = a.unit_ms - (wl_now_ms() - start);
+        if (left > 0) poll(NULL, 0, (int)left);
+        wl_line("IO", i + 1, a.units);
+    }
+    free(buf);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,39 @@
+// wl_mixed.c - a job that changes character as it runs, one phase per
+// unit in turn: CPU spin, sleep (I/O wait), a 16 KB output line, and a
+// unit with no output at all (the next line then covers two units).
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include "workload.h"
+
+#define OUTPUT_BYTES (16 * 1024)
+
+int main(int argc, char **argv) {
+    WlArgs a;
+    wl_parse(argc, argv, &a, NULL);
+    static char big[OUTPUT_BYTES];
+    memset(big, 'm', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\n';
+
+    for (int i = 0; i < a.units; i++) {
+        switch (i % 4) {
+        case 0:
+            wl_spin_ms(a.unit_ms);
+            wl_line("Mixed cpu", i + 1, a.units);
+            break;
+        case 1:
+            wl_sleep_ms(a.unit_ms);
+            wl_line("Mixed wait", i + 1, a.units);
+            break;
+        case 2:
+            fwrite(big, 1, sizeof(big), stdout);
+            fflush(stdout);
+            wl_sleep_ms(a.unit_ms);
+            break;
+        case 3:
+            wl_sleep_ms(a.unit_ms);  // silent
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,12 @@
+// wl_silent.c - a job that never prints: N units of sleeping, then exit.
+// The server only learns it is done at EOF, so nothing can preempt it
+// on line boundaries.
+#include <stddef.h>
+#include "workload.h"
+
+int main(int argc, char **argv) {
+    WlArgs a;
+    wl_parse(argc, argv, &a, NULL);
+    for (int i = 0; i < a.units; i++) wl_sleep_ms(a.unit_ms);
+    return 0;
+}
@@ -0,0 +1,14 @@
+// wl_spin.c - CPU-bound workload: each unit burns unit_ms of CPU time,
+// then prints its line.
+#include <stddef.h>
+#include "workload.h"
+
+int main(int argc, char **argv) {
+    WlArgs a;
+    wl_parse(argc, argv, &a, NULL);
+    for (int i = 0; i < a.units; i++) {
+        wl_spin_ms(a.unit_ms);
+        wl_line("Spin", i + 1, a.units);
+    }
+    return 0;
+}
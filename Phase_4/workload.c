@@ -0,0 +1,51 @@
+// workload.c - helpers for the wl_* workload programs
+#define _GNU_SOURCE
+#include "workload.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double cpu_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+double wl_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+void wl_parse(int argc, char **argv, WlArgs *a, const char *extra) {
+    a->units = argc > 1 ? atoi(argv[1]) : -1;
+    a->unit_ms = 1000;
+    const char *env = getenv("WL_UNIT_MS");
+    if (argc > 2) a->unit_ms = atoi(argv[2]);
+    else if (env) a->unit_ms = atoi(env);
+    if (a->units < 0 || a->unit_ms <= 0) {
+        fprintf(stderr, "Usage: %s <n> [unit_ms]%s%s\n", argv[0], extra ? " " : "",
+                extra ? extra : "");
+        exit(1);
+    }
+}
+
+void wl_line(const char *name, int i, int n) {
+    printf("%s %d/%d\n", name, i, n);
+    fflush(stdout);  // one line per unit must reach the pipe now
+}
+
+void wl_spin_ms(int ms) {
+    // CPU time, so a SIGSTOP in the middle doesn't eat into the unit
+    double end = cpu_ms() + ms;
+    volatile unsigned long x = 0;
+    while (cpu_ms() < end) {
+        for (int i = 0; i < 10000; i++) x += (unsigned long)i * i;
+    }
+}
+
+void wl_sleep_ms(int ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR) {}
+}
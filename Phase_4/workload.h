@@ -0,0 +1,29 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+// ---------------------------------------------------------------------------
+// Shared bits of the wl_* workload programs. Every workload is run as
+//   ./wl_<kind> N [unit_ms]
+// and lasts N time units. A unit is 1000 ms like demo.c, or unit_ms, or
+// $WL_UNIT_MS when the argument is left out (so a whole server run can be
+// sped up from its environment). The server charges one unit per output
+// line, so workloads that print write exactly one line per unit.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int units;
+    int unit_ms;
+} WlArgs;
+
+// Parses "N [unit_ms]"; prints usage and exits on bad input.
+// `extra` describes further arguments for the usage line (or NULL).
+void wl_parse(int argc, char **argv, WlArgs *a, const char *extra);
+
+// One progress line ("<name> i/n") + flush, like demo.c
+void wl_line(const char *name, int i, int n);
+
+void wl_spin_ms(int ms);     // burns ms of CPU time (not wall time)
+void wl_sleep_ms(int ms);
+double wl_now_ms(void);      // CLOCK_MONOTONIC
+
+#endif